@@ -0,0 +1,32 @@
+#include "fileindex.h"
+#include <algorithm>
+
+void FileIndex::clear() {
+    files.clear();
+}
+
+void FileIndex::append(const FileInfo &info) {
+    files.append(info);
+}
+
+int FileIndex::size() const {
+    return files.size();
+}
+
+//a file matches when its name contains every space-separated keyword
+FileIndex::Matches FileIndex::search(const QString &query) const {
+    QStringList keywords = query.split(" ");
+    Matches matches;
+
+    for (const FileInfo &f : files) {
+        bool match = std::all_of(keywords.begin(), keywords.end(), [&](const QString &kw) {
+            return f.filename.contains(kw, Qt::CaseInsensitive);
+        });
+        if (match) {
+            matches.names << f.filename;
+            matches.sizes << f.size;
+            matches.ids << QString(f.fileHash.toHex());
+        }
+    }
+    return matches;
+}
@@ -0,0 +1,36 @@
+#ifndef FILEINDEX_H
+#define FILEINDEX_H
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+//shared-directory index and the keyword search answered for SEARCH_REQUEST
+class FileIndex {
+public:
+    struct FileInfo {
+        QString filename;
+        qint64 size;
+        QDateTime modified;
+        QByteArray fileHash;
+    };
+
+    struct Matches {
+        QStringList names;
+        QList<qint64> sizes;
+        QStringList ids;  //hex file hashes
+        bool isEmpty() const { return names.isEmpty(); }
+    };
+
+    void clear();
+    void append(const FileInfo &info);
+    int size() const;
+    Matches search(const QString &query) const;
+
+private:
+    QList<FileInfo> files;
+};
+
+#endif
@@ -6,6 +6,8 @@
 #include "mainwindow.h"
 #include <QApplication>
 #include <QStringList>
+#include <QStandardPaths>
+#include <QMessageBox>
 
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
@@ -21,6 +23,38 @@ int main(int argc, char *argv[]) {
         QString path = args.value(idx + 1);
         window.setupFileWatcher(path);
     }
+    if (args.contains("-batchwindow")) {
+        //-batchwindow <ms>: outbound batching flush window, 0 turns batching off
+        window.setBatching(args.value(args.indexOf("-batchwindow") + 1).toInt());
+    }
+    if (args.contains("-stats")) {
+        //-stats <seconds> [-statsfile <path>]: periodic JSON metrics dump
+        int seconds = args.value(args.indexOf("-stats") + 1).toInt();
+        QString path;
+        if (args.contains("-statsfile")) path = args.value(args.indexOf("-statsfile") + 1);
+        window.setStatsDump(path, seconds * 1000);
+    }
+
+
+    //-port <port>: peer port, must match across nodes
+    //-mcast <group|none>: discovery multicast group, none falls back to broadcast
+    //-peers <ip,ip,...>: bootstrap peers for networks without multicast
+    quint16 port = Networking::DEFAULT_PEER_PORT;
+    if (args.contains("-port")) port = args.value(args.indexOf("-port") + 1).toUShort();
+    if (port == 0) port = Networking::DEFAULT_PEER_PORT;
+    QHostAddress group(QString::fromLatin1(Networking::DEFAULT_MULTICAST_GROUP));
+    if (args.contains("-mcast")) group = QHostAddress(args.value(args.indexOf("-mcast") + 1));
+    QStringList bootstrap;
+    if (args.contains("-peers")) bootstrap = args.value(args.indexOf("-peers") + 1).split(',', Qt::SkipEmptyParts);
+    //-history <dir|none>: on-disk chat history, kept in the app data directory by default
+    QString historyDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/history";
+    if (args.contains("-history")) historyDir = args.value(args.indexOf("-history") + 1);
+    if (historyDir != "none") window.openHistory(historyDir);
+
+    if (!window.startNetworking(port, group, bootstrap)) {
+        QMessageBox::critical(nullptr, "P2Pal", QString("Cannot listen on UDP port %1, is another node running here?").arg(port));
+        return 1;
+    }
 
     window.show();
     return app.exec();
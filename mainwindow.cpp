@@ -11,6 +11,7 @@
 #include <QCryptographicHash>
 #include <QThread>
 #include <QMessageBox>
+#include <QScrollBar>
 
 
 
@@ -24,34 +25,85 @@ MainWindow::MainWindow(QWidget *parent)
     connect(network, &Networking::fileRequestReceived, this, &MainWindow::handleFileRequest);
     connect(network, &Networking::blockReplyReceived, this, &MainWindow::handleBlockReply);
     connect(network, &Networking::searchReplyReceived, this, &MainWindow::handleSearchReply);
+    connect(network, &Networking::searchRequestReceived, this, &MainWindow::handleSearchRequest);
+    connect(network, &Networking::chatMessageReceived, this, &MainWindow::handleChatMessage);
+    connect(network, &Networking::privateMessageReceived, this, &MainWindow::handlePrivateMessage);
 
-    chatLog = new QTextEdit(this);
-    chatLog->setReadOnly(true);
+    //uniform rows let the view lay out only what is visible, however long the chat gets
+    chatModel = new ChatModel(ChatModel::DEFAULT_CAPACITY, this);
+    chatView = new QListView(this);
+    chatView->setModel(chatModel);
+    chatView->setUniformItemSizes(true);
+    chatView->setEditTriggers(QAbstractItemView::NoEditTriggers);
 
     inputField = new QLineEdit(this);
     connect(inputField, &QLineEdit::returnPressed, this, &MainWindow::sendMessage);
 
-    peerList = new QListWidget(this);
-    connect(peerList, &QListWidget::itemDoubleClicked, this, &MainWindow::sendPrivateMessage);
+    peerModel = new PeerListModel(this);
+    peerView = new QListView(this);
+    peerView->setModel(peerModel);
+    peerView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    connect(peerView, &QListView::doubleClicked, this, &MainWindow::sendPrivateMessage);
 
     auto *layout = new QVBoxLayout(ui->centralwidget);
-    layout->addWidget(chatLog);
-    layout->addWidget(peerList);
+    layout->addWidget(chatView);
+    layout->addWidget(peerView);
     layout->addWidget(inputField);
     addPeerButton = new QPushButton("Add Peer", this);
     layout->addWidget(addPeerButton);
     connect(addPeerButton, &QPushButton::clicked, this, &MainWindow::addPeer);
 
-    ui->searchResultsTable->setColumnCount(5);
-    QStringList headers = { "Filename", "Size (KB)", "Source Node", "Download", "Progress" };
-    ui->searchResultsTable->setHorizontalHeaderLabels(headers);
+    searchModel = new SearchResultsModel(SearchResultsModel::DEFAULT_CAPACITY, this);
+    searchProxy = new QSortFilterProxyModel(this);
+    searchProxy->setSourceModel(searchModel);
+    ui->searchResultsTable->setModel(searchProxy);
+    ui->searchResultsTable->setItemDelegateForColumn(SearchResultsModel::Progress, new ProgressDelegate(this));
+    connect(ui->searchResultsTable, &QTableView::doubleClicked, this, &MainWindow::downloadResult);
+    connect(ui->searchResultsTable, &QTableView::clicked, this, [this](const QModelIndex &index) {
+        if (index.column() == SearchResultsModel::Download) downloadResult(index);
+    });
 
+    refreshTimer = new QTimer(this);
+    refreshTimer->setSingleShot(true);
+    refreshTimer->setInterval(UI_REFRESH_MS);
+    connect(refreshTimer, &QTimer::timeout, this, &MainWindow::flushUiUpdates);
 
+    peerPollTimer = new QTimer(this);
+    connect(peerPollTimer, &QTimer::timeout, this, &MainWindow::updatePeerList);
+    peerPollTimer->start(PEER_POLL_MS);
 }
 void MainWindow::setNoForwardMode(bool mode) {
     network->setNoForwardMode(mode);
 }
 
+void MainWindow::setStatsDump(const QString &path, int intervalMs) {
+    network->setStatsDump(path, intervalMs);
+}
+
+void MainWindow::setBatching(int flushWindowMs) {
+    network->setBatching(flushWindowMs);
+}
+
+//bootstrap peers are optional; multicast discovery and peer exchange fill in the rest
+bool MainWindow::startNetworking(quint16 port, const QHostAddress &multicastGroup, const QStringList &bootstrapPeers) {
+    if (!network->listen(port)) return false;
+    network->setMulticastGroup(multicastGroup);
+    for (const QString &address : bootstrapPeers) {
+        QHostAddress peer(address.trimmed());
+        if (!peer.isNull()) network->addPeer(peer);
+    }
+    network->startPeerExchange();
+    network->startDiscovery();
+    return true;
+}
+
+void MainWindow::openHistory(const QString &directory) {
+    if (!network->openHistory(directory)) return;
+    for (const ChatMessage &msg : network->recentHistory(100)) {
+        queueChatLine((msg.origin == localIdentifier ? QString("Me") : msg.origin) + ": " + msg.chatText);
+    }
+}
+
 void MainWindow::addPeer() {
     bool ok;
     QString peerAddress = QInputDialog::getText(this, "Add Peer",
@@ -60,7 +112,7 @@ void MainWindow::addPeer() {
     if (ok && !peerAddress.isEmpty()) {
         QHostAddress peer(peerAddress);
         network->addPeer(peer);
-        chatLog->append("manually added peer: " + peerAddress);
+        queueChatLine("manually added peer: " + peerAddress);
     }
 }
 
@@ -74,25 +126,53 @@ void MainWindow::sendMessage() {
     QString message = inputField->text().trimmed();
     if (message.isEmpty()) return;
 
-    QVariantMap messageMap;
-    messageMap["Type"] = "CHAT";
-    messageMap["ChatText"] = message;
-    messageMap["Origin"] = localIdentifier;
-    messageMap["SequenceNumber"] = network->getNextSequenceNumber();
+    qDebug() << "Sending message to peers: " << message;
+    network->sendChat(message);  //with a HopLimit, neighbours relay it on
 
-    QByteArray datagram = QJsonDocument(QJsonObject::fromVariantMap(messageMap)).toJson();
+    queueChatLine("Me: " + message);
+    inputField->clear();
+}
 
-    qDebug() << "Sending message to peers: " << messageMap;
+void MainWindow::handleChatMessage(const QString &origin, int seqNum, const QString &chatText) {
+    Q_UNUSED(seqNum);
+    queueChatLine(origin + ": " + chatText);
+}
 
-    network->sendDatagram(datagram, messageMap["SequenceNumber"].toInt());
+void MainWindow::handlePrivateMessage(const QString &origin, const QString &chatText) {
+    queueChatLine("🔒 Private from " + origin + ": " + chatText);
+}
 
-    chatLog->append("Me: " + message);
-    inputField->clear();
+void MainWindow::queueChatLine(const QString &line) {
+    pendingChatLines << line;
+    scheduleRefresh();
+}
+
+//the first update arms the timer, everything arriving before it fires lands in the same refresh
+void MainWindow::scheduleRefresh() {
+    if (!refreshTimer->isActive()) refreshTimer->start();
+}
+
+void MainWindow::flushUiUpdates() {
+    if (!pendingChatLines.isEmpty()) {
+        QScrollBar *scroll = chatView->verticalScrollBar();
+        bool following = scroll->value() == scroll->maximum();
+        chatModel->appendLines(pendingChatLines);
+        pendingChatLines.clear();
+        if (following) chatView->scrollToBottom();
+    }
+    if (!pendingResults.isEmpty()) {
+        searchModel->appendResults(pendingResults);
+        pendingResults.clear();
+    }
+    for (auto it = pendingProgress.constBegin(); it != pendingProgress.constEnd(); ++it) {
+        searchModel->setProgress(it.key(), it.value());
+    }
+    pendingProgress.clear();
 }
 
 
 void MainWindow::processPendingDatagrams() {
-    network->processIncomingDatagrams(chatLog);
+    network->processIncomingDatagrams();  //chat reaches the view through chatMessageReceived
 }
 
 void MainWindow::discoverPeers() {
@@ -104,15 +184,16 @@ void MainWindow::runGossipProtocol() {
 }
 
 void MainWindow::updatePeerList() {
-    peerList->clear();
+    QStringList peers;
     for (const auto &peer : network->getPeers()) {
-        peerList->addItem(peer.toString());
+        peers << peer.toString();
     }
+    peerModel->setPeers(peers);
 }
 
 
 void MainWindow::sendPrivateMessage() {
-    QString dest = peerList->currentItem()->text();
+    QString dest = peerView->currentIndex().data().toString();
     if (dest.isEmpty()) return;
 
     QDialog *privateChatDialog = new QDialog(this);
@@ -165,55 +246,49 @@ void MainWindow::on_searchButton_clicked() {
     if (query.isEmpty()) return;
 
     QVariantMap msg;
+    msg["Type"] = "SEARCH_REQUEST";
     msg["Origin"] = localNodeID;
     msg["Search"] = query;
     msg["Budget"] = 20;
     msg["HopLimit"] = 10;
     sendToNeighbors(msg);
 }
-void MainWindow::handleSearchRequest(const QVariantMap &msg) {
-    QStringList keywords = msg["Search"].toString().split(" ");
-    QStringList matchNames, matchIDs;
-    QList<qint64> matchSizes;
-
-    for (const FileInfo &f : fileIndex) {
-        bool match = std::all_of(keywords.begin(), keywords.end(), [&](const QString &kw) {
-            return f.filename.contains(kw, Qt::CaseInsensitive);
-        });
-        if (match) {
-            matchNames << f.filename;
-            matchSizes << f.size;
-            matchIDs << QString(f.fileHash.toHex());
-        }
-    }
+void MainWindow::handleSearchRequest(const SearchRequestMessage &msg) {
+    FileIndex::Matches matches = fileIndex.search(msg.search);
 
-    if (!matchNames.isEmpty()) {
+    if (!matches.isEmpty()) {
         QVariantMap reply;
         reply["Type"] = "SEARCH_RESPONSE";
         reply["Origin"] = localNodeID;
-        reply["Dest"] = msg["Origin"].toString();
-        reply["MatchNames"] = matchNames;
-        reply["MatchSizes"] = QVariant::fromValue(matchSizes);
-        reply["MatchIDs"] = matchIDs;
-        sendTo(routingTable[reply["Dest"].toString()], reply);
+        reply["Dest"] = msg.origin;
+        reply["MatchNames"] = matches.names;
+        QVariantList sizes;
+        for (qint64 size : matches.sizes) sizes << size;
+        reply["MatchSizes"] = sizes;  //a plain list so it survives the JSON encoding
+        reply["MatchIDs"] = matches.ids;
+
+        const auto routes = network->getRoutingTable();
+        if (!routes.contains(msg.origin)) return;
+        sendTo(routes.value(msg.origin), reply);
     }
 }
 
 void MainWindow::sendTo(const QPair<QHostAddress, quint16> &target, const QVariantMap &msg) {
-    QByteArray datagram = QJsonDocument(QJsonObject::fromVariantMap(msg)).toJson();
-    udpSocket->writeDatagram(datagram, target.first, target.second);
+    network->sendTo(target, msg);
 }
 
 void MainWindow::sendToNeighbors(const QVariantMap &msg) {
-    QByteArray datagram = QJsonDocument(QJsonObject::fromVariantMap(msg)).toJson();
-
-    for (const QHostAddress &peer : network->getPeers()) {
-        udpSocket->writeDatagram(datagram, peer, Networking::DEFAULT_PEER_PORT);
+    network->sendToNeighbors(msg);
+}
 
+//false when the owner cannot be reached; a request over the transfer limit is queued and counts as sent
+bool MainWindow::requestFileDownload(const QString &fileHash, const QString &ownerID) {
+    const auto routes = network->getRoutingTable();
+    if (!routes.contains(ownerID)) {
+        qDebug() << "No route to" << ownerID << "for file" << fileHash;
+        return false;
     }
-}
 
-void MainWindow::requestFileDownload(const QString &fileHash, const QString &ownerID) {
     if (activeTransfers.size() < MAX_TRANSFERS) {
         activeTransfers.insert(fileHash);
 
@@ -223,22 +298,24 @@ void MainWindow::requestFileDownload(const QString &fileHash, const QString &own
         req["Dest"] = ownerID;
         req["Request"] = fileHash;
 
-        sendTo(routingTable[ownerID], req);
+        sendTo(routes.value(ownerID), req);
         fileOwner[fileHash] = ownerID;
     } else {
         pendingTransfers.enqueue(fileHash);
         fileOwner[fileHash] = ownerID;
     }
+    return true;
 }
 
-void MainWindow::handleFileRequest(const QVariantMap &msg) {
-    QString fileHash = msg["Request"].toString();
-    QString requestor = msg["Origin"].toString();
+void MainWindow::handleFileRequest(const FileRequestMessage &msg) {
+    QString fileHash = msg.request;
+    QString requestor = msg.origin;
 
-    if (!routingTable.contains(requestor)) return;
+    const auto routes = network->getRoutingTable();
+    if (!routes.contains(requestor)) return;
 
-    QHostAddress ip = routingTable[requestor].first;
-    quint16 port = routingTable[requestor].second;
+    QHostAddress ip = routes.value(requestor).first;
+    quint16 port = routes.value(requestor).second;
 
     sendFileBlocks(fileHash, ip, port, requestor);
 
@@ -268,11 +345,11 @@ void MainWindow::sendFileBlocks(const QString &fileHash, const QHostAddress &ip,
     }
 }
 
- void MainWindow::handleBlockReply(const QVariantMap &msg) {
-     QString hash = msg["BlockReply"].toString();
-     int id = msg["BlockID"].toInt();
-     int total = msg["TotalBlocks"].toInt();
-     QByteArray data = msg["BlockData"].toByteArray();
+ void MainWindow::handleBlockReply(const BlockReplyMessage &msg) {
+     const QString &hash = msg.blockReply;
+     int id = msg.blockID;
+     int total = msg.totalBlocks;
+     const QByteArray &data = msg.blockData;
 
      totalBlocks[hash] = total;
      receivedBlocks[hash].insert(id);
@@ -330,65 +407,40 @@ void MainWindow::sendFileBlocks(const QString &fileHash, const QHostAddress &ip,
      timer->start(5000);
  }
 
- void MainWindow::handleSearchReply(const QVariantMap &msg) {
-     QStringList names = msg["MatchNames"].toStringList();
-     QList<qint64> sizes = msg["MatchSizes"].value<QList<qint64>>();
-     QStringList hashes = msg["MatchIDs"].toStringList();
-     QString ownerID = msg["Origin"].toString();
-
-     for (int i = 0; i < names.size(); ++i) {
-         QString fileName = names[i];
-         qint64 sizeKB = sizes[i] / 1024;
-         QString fileHash = hashes[i];
-
-         int row = ui->searchResultsTable->rowCount();
-         ui->searchResultsTable->insertRow(row);
-
-         //Col 0: Filename
-         QTableWidgetItem *fileItem = new QTableWidgetItem(fileName);
-         fileItem->setData(Qt::UserRole, fileHash);
-         ui->searchResultsTable->setItem(row, 0, fileItem);
-
-         //cool1: Size
-         ui->searchResultsTable->setItem(row, 1, new QTableWidgetItem(QString::number(sizeKB)));
-
-         //col2: Owner
-         ui->searchResultsTable->setItem(row, 2, new QTableWidgetItem(ownerID));
-
-         //col3: Download Button
-         QPushButton *downloadBtn = new QPushButton("Download");
-         ui->searchResultsTable->setCellWidget(row, 3, downloadBtn);
-
-         connect(downloadBtn, &QPushButton::clicked, this, [=]() {
-             QString hash = ui->searchResultsTable->item(row, 0)->data(Qt::UserRole).toString();
-             QString owner = ui->searchResultsTable->item(row, 2)->text();
+ void MainWindow::handleSearchReply(const SearchResponseMessage &msg) {
+     for (int i = 0; i < msg.matchNames.size(); ++i) {
+         SearchResultsModel::Result result;
+         result.fileName = msg.matchNames[i];
+         result.size = msg.matchSizes[i];
+         result.owner = msg.origin;
+         result.hash = msg.matchIDs[i];
+         pendingResults << result;
+     }
+     scheduleRefresh();
+ }
 
-             //col 4: Progress Bar
-             QProgressBar *bar = new QProgressBar(this);
-             bar->setRange(0, 100);
-             bar->setValue(0);
-             ui->searchResultsTable->setCellWidget(row, 4, bar);
-             progressBars[hash] = bar;
+ void MainWindow::downloadResult(const QModelIndex &index) {
+     if (!index.isValid()) return;
+     const SearchResultsModel::Result &result = searchModel->result(searchProxy->mapToSource(index).row());
+     if (result.progress >= 0) return;  //already requested
 
-             requestFileDownload(hash, owner);
-         });
-     }
+     QString hash = result.hash;
+     QString owner = result.owner;
+     if (requestFileDownload(hash, owner)) searchModel->setProgress(hash, 0);
  }
 
+ //called for every block, the view only sees the latest value per refresh
  void MainWindow::updateProgressBar(const QString &fileHash, int percent) {
-     if (progressBars.contains(fileHash)) {
-         progressBars[fileHash]->setValue(percent);
-     }
+     pendingProgress[fileHash] = percent;
+     scheduleRefresh();
  }
 
  void MainWindow::notifyTransferFailed(const QString &fileHash) {
      qDebug() << "❌ Transfer failed for file:" << fileHash;
 
-     //it remove and delete progress bar if it exists
-     if (progressBars.contains(fileHash)) {
-         progressBars[fileHash]->deleteLater();
-         progressBars.remove(fileHash);
-     }
+     //back to "Download" so the user can retry
+     pendingProgress.remove(fileHash);
+     searchModel->setProgress(fileHash, -1);
 
      QMessageBox::warning(this, "Transfer Failed",
                           "The download failed for file with hash:\n" + fileHash +
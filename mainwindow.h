@@ -5,9 +5,14 @@
 #include <QTextEdit>
 #include <QLineEdit>
 #include <QPushButton>
-#include <QListWidget>
+#include <QListView>
+#include <QTableView>
+#include <QSortFilterProxyModel>
+#include <QTimer>
 #include <QUdpSocket>
 #include "networking.h"
+#include "fileindex.h"
+#include "uimodels.h"
 #include <QFileSystemWatcher>
 #include <QCryptographicHash>
 #include <QFileSystemWatcher>
@@ -21,7 +26,6 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QFile>
-#include <QProgressBar>
 
 
 
@@ -35,16 +39,20 @@ class MainWindow : public QMainWindow {
 public:
     explicit MainWindow(QWidget *parent = nullptr);
     void setNoForwardMode(bool mode);
+    void setStatsDump(const QString &path, int intervalMs);
+    void setBatching(int flushWindowMs);
+    bool startNetworking(quint16 port, const QHostAddress &multicastGroup, const QStringList &bootstrapPeers);
+    void openHistory(const QString &directory);
     ~MainWindow();
     void setupFileWatcher(const QString &directory);
 
 
 public slots:
     void on_searchButton_clicked();
-    void handleSearchRequest(const QVariantMap &msg);
-    void handleFileRequest(const QVariantMap &msg);
-    void handleBlockReply(const QVariantMap &msg);
-    void handleSearchReply(const QVariantMap &msg);
+    void handleSearchRequest(const SearchRequestMessage &msg);
+    void handleFileRequest(const FileRequestMessage &msg);
+    void handleBlockReply(const BlockReplyMessage &msg);
+    void handleSearchReply(const SearchResponseMessage &msg);
 
 
 
@@ -59,6 +67,10 @@ private slots:
     void updatePeerList();
     void addPeer();
     void sendTo(const QPair<QHostAddress, quint16> &target, const QVariantMap &msg);
+    void handleChatMessage(const QString &origin, int seqNum, const QString &chatText);
+    void handlePrivateMessage(const QString &origin, const QString &chatText);
+    void downloadResult(const QModelIndex &index);
+    void flushUiUpdates();
 
 
 
@@ -66,24 +78,31 @@ private slots:
 private:
     QString localIdentifier;
     Ui::MainWindow *ui;
-    QTextEdit *chatLog;
+    QListView *chatView;
+    ChatModel *chatModel;
     QLineEdit *inputField;
     QPushButton *addPeerButton;
-    QListWidget *peerList;
-    QUdpSocket *udpSocket;
+    QListView *peerView;
+    PeerListModel *peerModel;
+    SearchResultsModel *searchModel;
+    QSortFilterProxyModel *searchProxy;
     Networking *network;
-    struct FileInfo {
-        QString filename;
-        qint64 size;
-        QDateTime modified;
-        QByteArray fileHash;
-    };
-
-    QList<FileInfo> fileIndex;
+
+    //network-driven view updates are queued and applied together at most every UI_REFRESH_MS
+    QTimer *refreshTimer;
+    QTimer *peerPollTimer;
+    QStringList pendingChatLines;
+    QList<SearchResultsModel::Result> pendingResults;
+    QHash<QString, int> pendingProgress;  //fileHash: latest percent
+    const int UI_REFRESH_MS = 50;
+    const int PEER_POLL_MS = 1000;
+    void queueChatLine(const QString &line);
+    void scheduleRefresh();
+
+    FileIndex fileIndex;
     QFileSystemWatcher *fileWatcher;
     QString sharedDirectory;
     QString localNodeID;
-    QMap<QString, QPair<QHostAddress, quint16>> routingTable;
     void sendToNeighbors(const QVariantMap &msg);
     void updateFileIndex(const QString &directory);
     QMap<QString, QSet<int>> receivedBlocks;         //fileHash: set of received block IDs
@@ -102,8 +121,7 @@ private:
     void finalizeDownload(const QString &fileHash);
     void updateProgressBar(const QString &fileHash, int percent);
     void notifyTransferFailed(const QString &fileHash);
-    void requestFileDownload(const QString &fileHash, const QString &ownerID);
-    QMap<QString, QProgressBar*> progressBars;  //fileHash: progress bar
+    bool requestFileDownload(const QString &fileHash, const QString &ownerID);
 
 
 };
@@ -0,0 +1,138 @@
+#include "membership.h"
+#include <QRandomGenerator>
+
+Membership::Membership(int activeSize, int passiveSize)
+    : maxActive(qMax(1, activeSize)), maxPassive(qMax(0, passiveSize)) {}
+
+QList<QHostAddress> Membership::setSizes(int activeSize, int passiveSize) {
+    maxActive = qMax(1, activeSize);
+    maxPassive = qMax(0, passiveSize);
+    QList<QHostAddress> demoted;
+    while (active.size() > maxActive) {
+        QHostAddress peer = randomActive();
+        removeActive(peer);
+        demoted << peer;
+    }
+    trimPassive();
+    return demoted;
+}
+
+int Membership::activeCapacity() const {
+    return maxActive;
+}
+
+int Membership::passiveCapacity() const {
+    return maxPassive;
+}
+
+const QSet<QHostAddress> &Membership::activeView() const {
+    return active;
+}
+
+const QSet<QHostAddress> &Membership::passiveView() const {
+    return passive;
+}
+
+bool Membership::isActive(const QHostAddress &peer) const {
+    return active.contains(peer);
+}
+
+bool Membership::isKnown(const QHostAddress &peer) const {
+    return active.contains(peer) || passive.contains(peer);
+}
+
+bool Membership::activeFull() const {
+    return active.size() >= maxActive;
+}
+
+QHostAddress Membership::addActive(const QHostAddress &peer, qint64 nowMs) {
+    if (active.contains(peer)) return QHostAddress();
+
+    QHostAddress evicted;
+    if (activeFull()) {
+        evicted = randomActive();
+        removeActive(evicted);
+    }
+    passive.remove(peer);
+    active.insert(peer);
+    lastHeard.insert(peer, nowMs);
+    return evicted;
+}
+
+void Membership::addPassive(const QHostAddress &peer) {
+    if (peer.isNull() || active.contains(peer) || passive.contains(peer)) return;
+    passive.insert(peer);
+    trimPassive();
+}
+
+bool Membership::removeActive(const QHostAddress &peer) {
+    if (!active.remove(peer)) return false;
+    lastHeard.remove(peer);
+    passive.insert(peer);
+    trimPassive();
+    return true;
+}
+
+void Membership::dropPeer(const QHostAddress &peer) {
+    active.remove(peer);
+    passive.remove(peer);
+    lastHeard.remove(peer);
+}
+
+//called for every datagram, so only an existing entry is touched
+void Membership::heard(const QHostAddress &peer, qint64 nowMs) {
+    auto it = lastHeard.find(peer);
+    if (it != lastHeard.end()) it.value() = nowMs;
+}
+
+QList<QHostAddress> Membership::silentPeers(qint64 nowMs, qint64 timeoutMs) const {
+    QList<QHostAddress> silent;
+    for (auto it = lastHeard.constBegin(); it != lastHeard.constEnd(); ++it) {
+        if (nowMs - it.value() > timeoutMs) silent << it.key();
+    }
+    return silent;
+}
+
+QHostAddress Membership::randomActive(const QSet<QHostAddress> &exclude) const {
+    return randomOf(active, exclude);
+}
+
+QHostAddress Membership::randomPassive(const QSet<QHostAddress> &exclude) const {
+    return randomOf(passive, exclude);
+}
+
+QList<QHostAddress> Membership::sample(int count, const QHostAddress &except) const {
+    QList<QHostAddress> candidates;
+    candidates.reserve(active.size() + passive.size());
+    for (const auto &peer : active) {
+        if (peer != except) candidates << peer;
+    }
+    for (const auto &peer : passive) {
+        if (peer != except) candidates << peer;
+    }
+
+    //partial Fisher-Yates, only the sampled prefix is shuffled
+    count = qMin(int(candidates.size()), count);
+    for (int i = 0; i < count; ++i) {
+        int j = i + QRandomGenerator::global()->bounded(int(candidates.size()) - i);
+        candidates.swapItemsAt(i, j);
+    }
+    return candidates.mid(0, count);
+}
+
+QHostAddress Membership::randomOf(const QSet<QHostAddress> &view, const QSet<QHostAddress> &exclude) {
+    QList<QHostAddress> candidates;
+    candidates.reserve(view.size());
+    for (const auto &peer : view) {
+        if (!exclude.contains(peer)) candidates << peer;
+    }
+    if (candidates.isEmpty()) return QHostAddress();
+    return candidates[QRandomGenerator::global()->bounded(int(candidates.size()))];
+}
+
+//a full passive view drops a random entry, which keeps it a fresh sample of the network
+void Membership::trimPassive() {
+    while (passive.size() > maxPassive) {
+        passive.remove(randomOf(passive, QSet<QHostAddress>()));
+    }
+}
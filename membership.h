@@ -0,0 +1,47 @@
+#ifndef MEMBERSHIP_H
+#define MEMBERSHIP_H
+
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QSet>
+
+//HyParView-style partial views: a small active view of neighbours that carries all traffic,
+//and a larger passive view of backup peers used to replace active neighbours that fail
+class Membership {
+public:
+    explicit Membership(int activeSize = 5, int passiveSize = 30);
+    QList<QHostAddress> setSizes(int activeSize, int passiveSize);  //returns the neighbours demoted by a shrink
+    int activeCapacity() const;
+    int passiveCapacity() const;
+
+    const QSet<QHostAddress> &activeView() const;
+    const QSet<QHostAddress> &passiveView() const;
+    bool isActive(const QHostAddress &peer) const;
+    bool isKnown(const QHostAddress &peer) const;
+    bool activeFull() const;
+
+    QHostAddress addActive(const QHostAddress &peer, qint64 nowMs);  //returns the neighbour evicted to make room, if any
+    void addPassive(const QHostAddress &peer);
+    bool removeActive(const QHostAddress &peer);  //demotes to the passive view
+    void dropPeer(const QHostAddress &peer);      //forgets the peer in both views
+
+    void heard(const QHostAddress &peer, qint64 nowMs);
+    QList<QHostAddress> silentPeers(qint64 nowMs, qint64 timeoutMs) const;
+
+    QHostAddress randomActive(const QSet<QHostAddress> &exclude = QSet<QHostAddress>()) const;
+    QHostAddress randomPassive(const QSet<QHostAddress> &exclude = QSet<QHostAddress>()) const;
+    QList<QHostAddress> sample(int count, const QHostAddress &except) const;  //drawn from both views
+
+private:
+    static QHostAddress randomOf(const QSet<QHostAddress> &view, const QSet<QHostAddress> &exclude);
+    void trimPassive();
+
+    int maxActive;
+    int maxPassive;
+    QSet<QHostAddress> active;
+    QSet<QHostAddress> passive;
+    QHash<QHostAddress, qint64> lastHeard;  //uptime ms of the last datagram from each active neighbour
+};
+
+#endif
@@ -0,0 +1,16 @@
+#include "messagedispatcher.h"
+
+void MessageDispatcher::registerHandler(MessageType type, Handler handler) {
+    handlers[int(type)] = std::move(handler);
+}
+
+bool MessageDispatcher::hasHandler(MessageType type) const {
+    return bool(handlers[int(type)]);
+}
+
+bool MessageDispatcher::dispatch(const IncomingMessage &msg) const {
+    const Handler &handler = handlers[int(msg.type)];
+    if (!handler) return false;
+    handler(msg);
+    return true;
+}
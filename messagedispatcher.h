@@ -0,0 +1,42 @@
+#ifndef MESSAGEDISPATCHER_H
+#define MESSAGEDISPATCHER_H
+
+#include <QHostAddress>
+#include <QJsonObject>
+#include <array>
+#include <functional>
+#include <utility>
+#include "messagetypes.h"
+
+//a received datagram after the JSON parse; valid only for the duration of dispatch()
+struct IncomingMessage {
+    MessageType type;
+    const QJsonObject &json;
+    const QHostAddress &sender;
+    quint16 senderPort;
+    int size;
+};
+
+//handler table indexed by MessageType, replacing the string-compare chain on "Type"
+class MessageDispatcher {
+public:
+    using Handler = std::function<void(const IncomingMessage &)>;
+
+    void registerHandler(MessageType type, Handler handler);
+
+    //typed registration: Msg::fromJson runs only when a message of Msg::TYPE arrives
+    template <typename Msg, typename Fn>
+    void registerHandler(Fn handler) {
+        registerHandler(Msg::TYPE, [handler = std::move(handler)](const IncomingMessage &in) {
+            handler(Msg::fromJson(in.json), in);
+        });
+    }
+
+    bool hasHandler(MessageType type) const;
+    bool dispatch(const IncomingMessage &msg) const;  //false when no handler is registered
+
+private:
+    std::array<Handler, MESSAGE_TYPE_COUNT> handlers;
+};
+
+#endif
@@ -0,0 +1,326 @@
+#include "messagelog.h"
+#include <QDebug>
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <algorithm>
+#include <cstring>
+
+MessageLog::~MessageLog() {
+    close();
+}
+
+//segments are numbered in append order; the newest one is the only one written to
+bool MessageLog::open(const QString &directory) {
+    close();
+    lockedElsewhere = false;
+    if (!QDir().mkpath(directory)) {
+        qWarning() << "cannot create history directory" << directory;
+        return false;
+    }
+
+    lock = new QLockFile(QDir(directory).filePath("history.lock"));
+    lock->setStaleLockTime(0);  //held for the whole run; only a lock left by a dead process is stale
+    if (!lock->tryLock(0)) {
+        lockedElsewhere = lock->error() == QLockFile::LockFailedError;
+        qWarning() << "history directory" << directory
+                   << (lockedElsewhere ? "is in use by another instance" : "cannot be locked");
+        delete lock;
+        lock = nullptr;
+        return false;
+    }
+    dir = directory;
+
+    QList<int> ids;
+    const QStringList names = QDir(dir).entryList({"segment-*.log"}, QDir::Files);
+    for (const QString &name : names) {
+        bool ok = false;
+        int id = name.mid(8, name.size() - 12).toInt(&ok);
+        if (ok && id > 0) ids << id;
+    }
+    std::sort(ids.begin(), ids.end());
+
+    for (int i = 0; i < ids.size(); ++i) {
+        if (!loadSegment(ids[i], i == ids.size() - 1)) {
+            close();
+            return false;
+        }
+    }
+    if (ids.isEmpty() && !startSegment(1)) {
+        close();
+        return false;
+    }
+    activeSegment = segments.lastKey();
+    compact();
+    return true;
+}
+
+void MessageLog::close() {
+    for (auto it = segments.begin(); it != segments.end(); ++it) {
+        if (it->data) it->file->unmap(it->data);
+        delete it->file;
+    }
+    segments.clear();
+    index.clear();
+    activeSegment = 0;
+    delete lock;  //unlocks
+    lock = nullptr;
+}
+
+bool MessageLog::isOpen() const {
+    return !segments.isEmpty();
+}
+
+bool MessageLog::inUseElsewhere() const {
+    return lockedElsewhere;
+}
+
+void MessageLog::setSegmentBytes(qint64 bytes) {
+    segmentBytes = qMax<qint64>(4096, bytes);
+}
+
+void MessageLog::setRetention(int messagesPerOrigin) {
+    retention = qMax(1, messagesPerOrigin);
+}
+
+bool MessageLog::append(const QString &origin, int sequenceNumber, const QString &chatText) {
+    if (!isOpen() || contains(origin, sequenceNumber)) return false;
+
+    QJsonObject record;
+    record.insert(QLatin1String("Type"), QLatin1String("CHAT"));
+    record.insert(QLatin1String("Origin"), origin);
+    record.insert(QLatin1String("SequenceNumber"), sequenceNumber);
+    record.insert(QLatin1String("ChatText"), chatText);
+    QByteArray line = QJsonDocument(record).toJson(QJsonDocument::Compact);
+    line.append('\n');
+
+    if (segments[activeSegment].size > 0 && segments[activeSegment].size + line.size() > segmentBytes) {
+        if (!startSegment(activeSegment + 1)) return false;
+        compact();
+    }
+
+    Segment &seg = segments[activeSegment];
+    if (!seg.file->seek(seg.size) || seg.file->write(line) != line.size() || !seg.file->flush()) {
+        qWarning() << "history write failed:" << seg.file->errorString();
+        return false;
+    }
+    index[origin].insert(sequenceNumber, {activeSegment, seg.size, int(line.size() - 1)});
+    seg.size += line.size();
+    seg.records++;
+    seg.live++;
+    return true;
+}
+
+bool MessageLog::contains(const QString &origin, int sequenceNumber) const {
+    auto it = index.constFind(origin);
+    return it != index.constEnd() && it->contains(sequenceNumber);
+}
+
+int MessageLog::lastSequence(const QString &origin) const {
+    auto it = index.constFind(origin);
+    if (it == index.constEnd() || it->isEmpty()) return 0;
+    return it->lastKey();
+}
+
+QStringList MessageLog::origins() const {
+    return index.keys();
+}
+
+QList<QByteArray> MessageLog::range(const QString &origin, int afterSequence, int limit) const {
+    QList<QByteArray> records;
+    auto it = index.constFind(origin);
+    if (it == index.constEnd()) return records;
+
+    for (auto rec = it->upperBound(afterSequence); rec != it->constEnd() && records.size() < limit; ++rec) {
+        const Location &loc = rec.value();
+        const char *data = bytes(loc.segment, loc.offset + loc.length);
+        if (!data) break;
+        records << QByteArray(data + loc.offset, loc.length);
+    }
+    return records;
+}
+
+//walks the newest segments backwards line by line, so startup only touches the end of the log
+QList<ChatMessage> MessageLog::tail(int count) const {
+    QList<ChatMessage> messages;
+    for (auto it = segments.constEnd(); it != segments.constBegin() && messages.size() < count;) {
+        --it;
+        const char *data = bytes(it.key(), it->size);
+        if (!data) continue;
+
+        qint64 end = it->size - 1;  //newline that ends the last record
+        while (end > 0 && messages.size() < count) {
+            qint64 start = end - 1;
+            while (start >= 0 && data[start] != '\n') --start;
+            QByteArray line = QByteArray::fromRawData(data + start + 1, end - start - 1);
+            ChatMessage msg = ChatMessage::fromJson(QJsonDocument::fromJson(line).object());
+            if (contains(msg.origin, msg.sequenceNumber)) messages << msg;
+            end = start;
+        }
+    }
+    std::reverse(messages.begin(), messages.end());
+    return messages;
+}
+
+//records beyond the per-origin retention leave the index; sealed segments with nothing
+//left are deleted and those that are mostly dead are rewritten with only the live records
+void MessageLog::compact() {
+    for (auto it = index.begin(); it != index.end(); ++it) {
+        QMap<int, Location> &entries = it.value();
+        while (entries.size() > retention) {
+            segments[entries.first().segment].live--;
+            entries.erase(entries.begin());
+        }
+    }
+
+    const QList<int> ids = segments.keys();
+    for (int id : ids) {
+        if (id == activeSegment) continue;
+        const Segment &seg = segments[id];
+        if (seg.live <= 0) {
+            removeSegment(id);
+        } else if (seg.live * 2 < seg.records) {
+            rewriteSegment(id);
+        }
+    }
+}
+
+int MessageLog::segmentCount() const {
+    return segments.size();
+}
+
+int MessageLog::recordCount() const {
+    int records = 0;
+    for (const Segment &seg : segments) records += seg.live;
+    return records;
+}
+
+qint64 MessageLog::sizeOnDisk() const {
+    qint64 size = 0;
+    for (const Segment &seg : segments) size += seg.size;
+    return size;
+}
+
+QString MessageLog::segmentPath(int id) const {
+    return QDir(dir).filePath(QString("segment-%1.log").arg(id, 8, 10, QChar('0')));
+}
+
+//rebuilds the index entries of one segment; a torn last line left by a crash is cut off
+bool MessageLog::loadSegment(int id, bool writable) {
+    Segment seg;
+    seg.file = new QFile(segmentPath(id));
+    if (!seg.file->open(writable ? QIODevice::ReadWrite : QIODevice::ReadOnly)) {
+        qWarning() << "cannot open history segment" << seg.file->fileName() << ":" << seg.file->errorString();
+        delete seg.file;
+        return false;
+    }
+    seg.size = seg.file->size();
+    segments.insert(id, seg);
+
+    const char *data = bytes(id, seg.size);
+    if (seg.size > 0 && !data) return false;
+
+    qint64 pos = 0;
+    while (pos < seg.size) {
+        const char *newline = static_cast<const char *>(memchr(data + pos, '\n', size_t(seg.size - pos)));
+        if (!newline) break;
+        qint64 length = newline - (data + pos);
+        const QJsonObject record = QJsonDocument::fromJson(QByteArray::fromRawData(data + pos, int(length))).object();
+        if (!record.isEmpty()) {
+            Segment &loaded = segments[id];
+            loaded.records++;
+            QMap<int, Location> &entries = index[record.value(QLatin1String("Origin")).toString()];
+            int seq = record.value(QLatin1String("SequenceNumber")).toInt();
+            if (!entries.contains(seq)) {
+                entries.insert(seq, {id, pos, int(length)});
+                loaded.live++;
+            }
+        }
+        pos += length + 1;
+    }
+
+    if (pos < seg.size) {
+        Segment &torn = segments[id];
+        qWarning() << "history segment" << torn.file->fileName() << "ends in a partial record, truncating";
+        if (torn.data) torn.file->unmap(torn.data);
+        torn.data = nullptr;
+        torn.mapped = 0;
+        if (writable) torn.file->resize(pos);
+        torn.size = pos;
+    }
+    return true;
+}
+
+bool MessageLog::startSegment(int id) {
+    Segment seg;
+    seg.file = new QFile(segmentPath(id));
+    if (!seg.file->open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        qWarning() << "cannot create history segment" << seg.file->fileName() << ":" << seg.file->errorString();
+        delete seg.file;
+        return false;
+    }
+    segments.insert(id, seg);
+    activeSegment = id;
+    return true;
+}
+
+//the active segment grows after it is mapped, so it is remapped when a read goes past the mapping
+const char *MessageLog::bytes(int id, qint64 end) const {
+    auto it = segments.find(id);
+    if (it == segments.end()) return nullptr;
+    Segment &seg = it.value();
+    if (end > seg.mapped) {
+        if (seg.data) seg.file->unmap(seg.data);
+        seg.data = seg.size > 0 ? seg.file->map(0, seg.size) : nullptr;
+        seg.mapped = seg.data ? seg.size : 0;
+        if (!seg.data) return nullptr;
+    }
+    return reinterpret_cast<const char *>(seg.data);
+}
+
+void MessageLog::rewriteSegment(int id) {
+    QList<Location *> live;
+    for (auto it = index.begin(); it != index.end(); ++it) {
+        for (auto rec = it->begin(); rec != it->end(); ++rec) {
+            if (rec->segment == id) live << &rec.value();
+        }
+    }
+    std::sort(live.begin(), live.end(), [](const Location *a, const Location *b) { return a->offset < b->offset; });
+
+    const char *data = bytes(id, segments[id].size);
+    QSaveFile out(segmentPath(id));
+    if (!data || !out.open(QIODevice::WriteOnly)) return;
+
+    QList<qint64> offsets;
+    qint64 pos = 0;
+    for (const Location *loc : live) {
+        out.write(data + loc->offset, loc->length + 1);
+        offsets << pos;
+        pos += loc->length + 1;
+    }
+
+    Segment &seg = segments[id];
+    seg.file->unmap(seg.data);
+    seg.data = nullptr;
+    seg.mapped = 0;
+    seg.file->close();
+    bool committed = out.commit();
+    seg.file->open(QIODevice::ReadOnly);
+    if (!committed) {
+        qWarning() << "history compaction failed for" << seg.file->fileName();
+        return;
+    }
+
+    for (int i = 0; i < live.size(); ++i) live[i]->offset = offsets[i];
+    seg.size = pos;
+    seg.records = live.size();
+    seg.live = live.size();
+}
+
+void MessageLog::removeSegment(int id) {
+    Segment seg = segments.take(id);
+    if (seg.data) seg.file->unmap(seg.data);
+    seg.file->remove();
+    delete seg.file;
+}
@@ -0,0 +1,78 @@
+#ifndef MESSAGELOG_H
+#define MESSAGELOG_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QLockFile>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include "messages.h"
+
+//append-only chat history on disk, split into numbered segment files of one compact CHAT
+//datagram per line. Reads go through memory maps of the segments, and an in-memory index
+//by (origin, sequence number) points at each record, so catch-up requests are answered
+//straight from the page cache. The directory is locked while open, since two processes
+//appending to the same segments would corrupt them.
+class MessageLog {
+public:
+    ~MessageLog();
+
+    bool open(const QString &directory);
+    void close();
+    bool isOpen() const;
+    bool inUseElsewhere() const;  //the last open() failed because another process holds the directory
+    void setSegmentBytes(qint64 bytes);
+    void setRetention(int messagesPerOrigin);
+
+    bool append(const QString &origin, int sequenceNumber, const QString &chatText);
+    bool contains(const QString &origin, int sequenceNumber) const;
+    int lastSequence(const QString &origin) const;  //0 for unknown origins
+    QStringList origins() const;
+    QList<QByteArray> range(const QString &origin, int afterSequence, int limit) const;  //ascending
+    QList<ChatMessage> tail(int count) const;  //most recent records, oldest first
+    void compact();
+
+    int segmentCount() const;
+    int recordCount() const;
+    qint64 sizeOnDisk() const;
+
+    constexpr static qint64 DEFAULT_SEGMENT_BYTES = 4 * 1024 * 1024;
+    constexpr static int DEFAULT_RETENTION = 10000;
+
+private:
+    struct Location {
+        int segment;
+        qint64 offset;
+        int length;  //without the newline
+    };
+
+    struct Segment {
+        QFile *file = nullptr;
+        uchar *data = nullptr;  //mapping of the first mapped bytes
+        qint64 mapped = 0;
+        qint64 size = 0;
+        int records = 0;  //lines in the file
+        int live = 0;     //lines still referenced by the index
+    };
+
+    QString segmentPath(int id) const;
+    bool loadSegment(int id, bool writable);
+    bool startSegment(int id);
+    const char *bytes(int id, qint64 end) const;
+    void rewriteSegment(int id);
+    void removeSegment(int id);
+
+    QString dir;
+    QLockFile *lock = nullptr;
+    bool lockedElsewhere = false;
+    qint64 segmentBytes = DEFAULT_SEGMENT_BYTES;
+    int retention = DEFAULT_RETENTION;
+    int activeSegment = 0;
+    mutable QMap<int, Segment> segments;  //mutable: the active segment is remapped lazily as it grows
+    QHash<QString, QMap<int, Location>> index;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "messages.h"
+#include <QJsonArray>
+
+namespace {
+QStringList toStringList(const QJsonValue &value) {
+    QStringList list;
+    const QJsonArray array = value.toArray();
+    list.reserve(array.size());
+    for (const QJsonValue &v : array) list << v.toString();
+    return list;
+}
+}
+
+ChatMessage ChatMessage::fromJson(const QJsonObject &obj) {
+    ChatMessage msg;
+    msg.origin = obj.value(QLatin1String("Origin")).toString();
+    msg.sequenceNumber = obj.value(QLatin1String("SequenceNumber")).toInt();
+    msg.chatText = obj.value(QLatin1String("ChatText")).toString();
+    const QJsonValue hop = obj.value(QLatin1String("HopLimit"));
+    msg.hopLimit = hop.isUndefined() ? -1 : hop.toInt();
+    return msg;
+}
+
+PrivateChatMessage PrivateChatMessage::fromJson(const QJsonObject &obj) {
+    PrivateChatMessage msg;
+    msg.origin = obj.value(QLatin1String("Origin")).toString();
+    msg.dest = obj.value(QLatin1String("Dest")).toString();
+    msg.chatText = obj.value(QLatin1String("ChatText")).toString();
+    msg.hopLimit = obj.value(QLatin1String("HopLimit")).toInt();
+    return msg;
+}
+
+RouteRumorMessage RouteRumorMessage::fromJson(const QJsonObject &obj) {
+    RouteRumorMessage msg;
+    msg.origin = obj.value(QLatin1String("Origin")).toString();
+    msg.seqNo = obj.value(QLatin1String("SeqNo")).toInt();
+    const QJsonValue ip = obj.value(QLatin1String("LastIP"));
+    const QJsonValue port = obj.value(QLatin1String("LastPort"));
+    msg.hasLastAddress = !ip.isUndefined() && !port.isUndefined();
+    if (msg.hasLastAddress) {
+        msg.lastIP = ip.toString();
+        msg.lastPort = quint16(port.toInt());
+    }
+    return msg;
+}
+
+FileRequestMessage FileRequestMessage::fromJson(const QJsonObject &obj) {
+    FileRequestMessage msg;
+    msg.origin = obj.value(QLatin1String("Origin")).toString();
+    msg.dest = obj.value(QLatin1String("Dest")).toString();
+    msg.request = obj.value(QLatin1String("Request")).toString();
+    return msg;
+}
+
+BlockReplyMessage BlockReplyMessage::fromJson(const QJsonObject &obj) {
+    BlockReplyMessage msg;
+    msg.origin = obj.value(QLatin1String("Origin")).toString();
+    msg.dest = obj.value(QLatin1String("Dest")).toString();
+    msg.blockReply = obj.value(QLatin1String("BlockReply")).toString();
+    msg.blockID = obj.value(QLatin1String("BlockID")).toInt();
+    msg.totalBlocks = obj.value(QLatin1String("TotalBlocks")).toInt();
+    msg.blockData = obj.value(QLatin1String("BlockData")).toString().toUtf8();
+    return msg;
+}
+
+SearchRequestMessage SearchRequestMessage::fromJson(const QJsonObject &obj) {
+    SearchRequestMessage msg;
+    msg.origin = obj.value(QLatin1String("Origin")).toString();
+    msg.search = obj.value(QLatin1String("Search")).toString();
+    msg.budget = obj.value(QLatin1String("Budget")).toInt();
+    msg.hopLimit = obj.value(QLatin1String("HopLimit")).toInt();
+    return msg;
+}
+
+SearchResponseMessage SearchResponseMessage::fromJson(const QJsonObject &obj) {
+    SearchResponseMessage msg;
+    msg.origin = obj.value(QLatin1String("Origin")).toString();
+    msg.dest = obj.value(QLatin1String("Dest")).toString();
+    msg.matchNames = toStringList(obj.value(QLatin1String("MatchNames")));
+    msg.matchIDs = toStringList(obj.value(QLatin1String("MatchIDs")));
+
+    const QJsonArray sizes = obj.value(QLatin1String("MatchSizes")).toArray();
+    msg.matchSizes.reserve(msg.matchNames.size());
+    for (const QJsonValue &v : sizes) msg.matchSizes << qint64(v.toDouble());
+    while (msg.matchSizes.size() < msg.matchNames.size()) msg.matchSizes << 0;
+    while (msg.matchIDs.size() < msg.matchNames.size()) msg.matchIDs << QString();
+    return msg;
+}
+
+PeerExchangeMessage PeerExchangeMessage::fromJson(const QJsonObject &obj) {
+    PeerExchangeMessage msg;
+    msg.origin = obj.value(QLatin1String("Origin")).toString();
+    msg.peers = toStringList(obj.value(QLatin1String("Peers")));
+    msg.reply = obj.value(QLatin1String("Reply")).toBool();
+    return msg;
+}
+
+ForwardJoinMessage ForwardJoinMessage::fromJson(const QJsonObject &obj) {
+    ForwardJoinMessage msg;
+    msg.origin = obj.value(QLatin1String("Origin")).toString();
+    msg.newNode = obj.value(QLatin1String("NewNode")).toString();
+    msg.ttl = obj.value(QLatin1String("TTL")).toInt();
+    return msg;
+}
+
+NeighborMessage NeighborMessage::fromJson(const QJsonObject &obj) {
+    NeighborMessage msg;
+    msg.origin = obj.value(QLatin1String("Origin")).toString();
+    msg.highPriority = obj.value(QLatin1String("HighPriority")).toBool();
+    return msg;
+}
+
+NeighborReplyMessage NeighborReplyMessage::fromJson(const QJsonObject &obj) {
+    NeighborReplyMessage msg;
+    msg.origin = obj.value(QLatin1String("Origin")).toString();
+    msg.accepted = obj.value(QLatin1String("Accepted")).toBool();
+    return msg;
+}
@@ -0,0 +1,121 @@
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include "messagetypes.h"
+
+//typed views of the wire messages; each is only built when a handler for its type runs,
+//and only reads the fields that message carries
+
+struct ChatMessage {
+    static constexpr MessageType TYPE = MessageType::Chat;
+    QString origin;
+    int sequenceNumber = 0;
+    QString chatText;
+    int hopLimit = -1;  //-1 when the message carries no HopLimit
+
+    static ChatMessage fromJson(const QJsonObject &obj);
+};
+
+struct PrivateChatMessage {
+    static constexpr MessageType TYPE = MessageType::PrivateMessage;
+    QString origin;
+    QString dest;
+    QString chatText;
+    int hopLimit = 0;
+
+    static PrivateChatMessage fromJson(const QJsonObject &obj);
+};
+
+struct RouteRumorMessage {
+    static constexpr MessageType TYPE = MessageType::RouteRumor;
+    QString origin;
+    int seqNo = 0;
+    QString lastIP;
+    quint16 lastPort = 0;
+    bool hasLastAddress = false;
+
+    static RouteRumorMessage fromJson(const QJsonObject &obj);
+};
+
+struct FileRequestMessage {
+    static constexpr MessageType TYPE = MessageType::FileRequest;
+    QString origin;
+    QString dest;
+    QString request;  //hex file hash
+
+    static FileRequestMessage fromJson(const QJsonObject &obj);
+};
+
+struct BlockReplyMessage {
+    static constexpr MessageType TYPE = MessageType::BlockReply;
+    QString origin;
+    QString dest;
+    QString blockReply;  //hex file hash
+    int blockID = 0;
+    int totalBlocks = 0;
+    QByteArray blockData;
+
+    static BlockReplyMessage fromJson(const QJsonObject &obj);
+};
+
+struct SearchRequestMessage {
+    static constexpr MessageType TYPE = MessageType::SearchRequest;
+    QString origin;
+    QString search;
+    int budget = 0;
+    int hopLimit = 0;
+
+    static SearchRequestMessage fromJson(const QJsonObject &obj);
+};
+
+struct SearchResponseMessage {
+    static constexpr MessageType TYPE = MessageType::SearchResponse;
+    QString origin;
+    QString dest;
+    QStringList matchNames;
+    QList<qint64> matchSizes;  //padded with 0 to matchNames.size()
+    QStringList matchIDs;
+
+    static SearchResponseMessage fromJson(const QJsonObject &obj);
+};
+
+struct PeerExchangeMessage {
+    static constexpr MessageType TYPE = MessageType::PeerExchange;
+    QString origin;
+    QStringList peers;   //random sample of the sender's peer table
+    bool reply = false;  //true when answering another node's exchange
+
+    static PeerExchangeMessage fromJson(const QJsonObject &obj);
+};
+
+struct ForwardJoinMessage {
+    static constexpr MessageType TYPE = MessageType::ForwardJoin;
+    QString origin;
+    QString newNode;  //address of the joining node
+    int ttl = 0;      //remaining random walk length
+
+    static ForwardJoinMessage fromJson(const QJsonObject &obj);
+};
+
+struct NeighborMessage {
+    static constexpr MessageType TYPE = MessageType::Neighbor;
+    QString origin;
+    bool highPriority = false;  //set when the sender has no active neighbours left
+
+    static NeighborMessage fromJson(const QJsonObject &obj);
+};
+
+struct NeighborReplyMessage {
+    static constexpr MessageType TYPE = MessageType::NeighborReply;
+    QString origin;
+    bool accepted = false;
+
+    static NeighborReplyMessage fromJson(const QJsonObject &obj);
+};
+
+#endif
@@ -0,0 +1,56 @@
+#include "messagetypes.h"
+#include <QHash>
+#include <QJsonObject>
+#include <QJsonValue>
+
+namespace {
+const char *const typeNames[MESSAGE_TYPE_COUNT] = {
+    "CHAT",
+    "DISCOVERY",
+    "DISCOVERY_RESPONSE",
+    "PRIVATE_MESSAGE",
+    "ROUTE_RUMOR",
+    "FILE_REQUEST",
+    "BLOCK_REPLY",
+    "SEARCH_REQUEST",
+    "SEARCH_RESPONSE",
+    "PING",
+    "PONG",
+    "STATS_REQUEST",
+    "STATS",
+    "BATCH",
+    "PEER_EXCHANGE",
+    "JOIN",
+    "FORWARD_JOIN",
+    "NEIGHBOR",
+    "NEIGHBOR_REPLY",
+    "DISCONNECT",
+    "CATCHUP_REQUEST",
+    "CATCHUP_DONE",
+    "UNKNOWN",
+};
+}
+
+//one hash lookup per message instead of a compare per known type
+MessageType messageTypeFromString(const QString &type) {
+    static const QHash<QString, MessageType> byName = []() {
+        QHash<QString, MessageType> names;
+        names.reserve(int(MessageType::Unknown));
+        for (int i = 0; i < int(MessageType::Unknown); ++i) {
+            names.insert(QString::fromLatin1(typeNames[i]), MessageType(i));
+        }
+        return names;
+    }();
+    return byName.value(type, MessageType::Unknown);
+}
+
+//a missing or non-string Type is rejected before any string is built from it
+MessageType messageTypeOf(const QJsonObject &message) {
+    const QJsonValue type = message.value(QLatin1String("Type"));
+    if (!type.isString()) return MessageType::Unknown;
+    return messageTypeFromString(type.toString());
+}
+
+const char *messageTypeName(MessageType type) {
+    return typeNames[int(type)];
+}
@@ -0,0 +1,41 @@
+#ifndef MESSAGETYPES_H
+#define MESSAGETYPES_H
+
+#include <QString>
+
+//wire "Type" values, as a compact enum for counters and dispatch
+enum class MessageType : quint8 {
+    Chat,
+    Discovery,
+    DiscoveryResponse,
+    PrivateMessage,
+    RouteRumor,
+    FileRequest,
+    BlockReply,
+    SearchRequest,
+    SearchResponse,
+    Ping,
+    Pong,
+    StatsRequest,
+    Stats,
+    Batch,
+    PeerExchange,
+    Join,
+    ForwardJoin,
+    Neighbor,
+    NeighborReply,
+    Disconnect,
+    CatchUpRequest,
+    CatchUpDone,
+    Unknown
+};
+
+constexpr int MESSAGE_TYPE_COUNT = int(MessageType::Unknown) + 1;
+
+class QJsonObject;
+
+MessageType messageTypeFromString(const QString &type);
+MessageType messageTypeOf(const QJsonObject &message);  //from the message's "Type" field
+const char *messageTypeName(MessageType type);
+
+#endif
@@ -0,0 +1,187 @@
+#include "metrics.h"
+#include <QtAlgorithms>
+
+void NetworkMetrics::Histogram::record(qint64 ns) {
+    if (ns < 0) ns = 0;
+    int bits = 64 - qCountLeadingZeroBits(quint64(ns));
+    int bucket = qBound(0, bits - 9, BUCKETS - 1);
+    counts[bucket]++;
+    total++;
+    sumNs += quint64(ns);
+}
+
+//upper bound of the bucket holding the p-th sample, in microseconds
+double NetworkMetrics::Histogram::percentileUs(double p) const {
+    if (total == 0) return 0;
+    quint64 rank = quint64(p * total);
+    quint64 seen = 0;
+    for (int i = 0; i < BUCKETS; ++i) {
+        seen += counts[i];
+        if (seen > rank) return double(quint64(1) << (i + 9)) / 1000.0;
+    }
+    return double(quint64(1) << (BUCKETS + 8)) / 1000.0;
+}
+
+NetworkMetrics::NetworkMetrics() {
+    clock.start();
+}
+
+void NetworkMetrics::recordIn(MessageType type, const QHostAddress &peer, int bytes) {
+    TypeStats &t = types[int(type)];
+    t.messagesIn++;
+    t.bytesIn += bytes;
+    PeerStats &p = peers[peer];
+    p.datagramsIn++;
+    p.bytesIn += bytes;
+    bytesInTotal += bytes;
+    datagramsInTotal++;
+}
+
+void NetworkMetrics::recordBatchedIn(MessageType type) {
+    types[int(type)].batchedIn++;
+}
+
+void NetworkMetrics::recordOut(MessageType type, const QHostAddress &peer, int bytes) {
+    TypeStats &t = types[int(type)];
+    t.messagesOut++;
+    t.bytesOut += bytes;
+    if (!peer.isMulticast() && !peer.isBroadcast()) {  //discovery targets are not peers
+        PeerStats &p = peers[peer];
+        p.datagramsOut++;
+        p.bytesOut += bytes;
+    }
+    bytesOutTotal += bytes;
+    datagramsOutTotal++;
+}
+
+void NetworkMetrics::recordHandler(MessageType type, qint64 ns) {
+    types[int(type)].handler.record(ns);
+}
+
+void NetworkMetrics::recordDrop(DropReason reason) {
+    drops[reason]++;
+}
+
+void NetworkMetrics::recordReceiveBatch(int datagrams) {
+    lastReceiveBatch = datagrams;
+    maxReceiveBatch = qMax(maxReceiveBatch, datagrams);
+}
+
+void NetworkMetrics::recordPing(const QHostAddress &peer) {
+    peers[peer].pingsSent++;
+}
+
+void NetworkMetrics::recordPong(const QHostAddress &peer, double rttMs) {
+    PeerStats &p = peers[peer];
+    p.pongsReceived++;
+    p.lastRttMs = rttMs;
+    p.smoothedRttMs = p.smoothedRttMs < 0 ? rttMs : 0.875 * p.smoothedRttMs + 0.125 * rttMs;
+}
+
+void NetworkMetrics::retainPeers(const QSet<QHostAddress> &keep) {
+    for (auto it = peers.begin(); it != peers.end();) {
+        if (keep.contains(it.key())) {
+            ++it;
+        } else {
+            it = peers.erase(it);
+        }
+    }
+}
+
+qint64 NetworkMetrics::uptimeMs() const {
+    return clock.elapsed();
+}
+
+QJsonObject NetworkMetrics::snapshot() const {
+
+    QJsonObject totals;
+    totals["datagrams_in"] = double(datagramsInTotal);
+    totals["bytes_in"] = double(bytesInTotal);
+    totals["datagrams_out"] = double(datagramsOutTotal);
+    totals["bytes_out"] = double(bytesOutTotal);
+
+    QJsonObject dropObj;
+    dropObj["parse_error"] = double(drops[ParseError]);
+    dropObj["hop_limit"] = double(drops[HopLimit]);
+    dropObj["duplicate"] = double(drops[Duplicate]);
+    dropObj["unknown_type"] = double(drops[UnknownType]);
+    dropObj["no_route"] = double(drops[NoRoute]);
+
+    QJsonObject batch;
+    batch["last"] = lastReceiveBatch;
+    batch["max"] = maxReceiveBatch;
+
+    QJsonObject typeObj;
+    for (int i = 0; i < MESSAGE_TYPE_COUNT; ++i) {
+        const TypeStats &t = types[i];
+        if (t.messagesIn == 0 && t.batchedIn == 0 && t.messagesOut == 0) continue;
+
+        QJsonObject handler;
+        handler["count"] = double(t.handler.total);
+        handler["mean_us"] = t.handler.total ? t.handler.sumNs / 1000.0 / t.handler.total : 0.0;
+        handler["p50_us"] = t.handler.percentileUs(0.50);
+        handler["p99_us"] = t.handler.percentileUs(0.99);
+
+        QJsonObject o;
+        o["messages_in"] = double(t.messagesIn);
+        o["batched_in"] = double(t.batchedIn);
+        o["bytes_in"] = double(t.bytesIn);
+        o["messages_out"] = double(t.messagesOut);
+        o["bytes_out"] = double(t.bytesOut);
+        o["handler"] = handler;
+        typeObj[messageTypeName(MessageType(i))] = o;
+    }
+
+    QJsonObject peerObj;
+    for (auto it = peers.constBegin(); it != peers.constEnd(); ++it) {
+        const PeerStats &p = it.value();
+        QJsonObject o;
+        o["datagrams_in"] = double(p.datagramsIn);
+        o["bytes_in"] = double(p.bytesIn);
+        o["datagrams_out"] = double(p.datagramsOut);
+        o["bytes_out"] = double(p.bytesOut);
+        if (p.pingsSent > 0) {
+            o["rtt_ms"] = p.lastRttMs;
+            o["srtt_ms"] = p.smoothedRttMs;
+            o["loss"] = 1.0 - qMin(1.0, double(p.pongsReceived) / p.pingsSent);
+        }
+        peerObj[it.key().toString()] = o;
+    }
+
+    QJsonObject snap;
+    snap["uptime_ms"] = double(clock.elapsed());
+    snap["totals"] = totals;
+    snap["drops"] = dropObj;
+    snap["receive_batch"] = batch;
+    snap["types"] = typeObj;
+    snap["peers"] = peerObj;
+    return snap;
+}
+
+QJsonObject NetworkMetrics::rates() {
+    qint64 now = clock.elapsed();
+    double windowSec = qMax<qint64>(1, now - windowStartMs) / 1000.0;
+
+    QJsonObject typeObj;
+    for (int i = 0; i < MESSAGE_TYPE_COUNT; ++i) {
+        const TypeStats &t = types[i];
+        if (t.bytesIn == windowBytesIn[i] && t.bytesOut == windowBytesOut[i]) continue;
+        QJsonObject o;
+        o["bytes_in_per_sec"] = (t.bytesIn - windowBytesIn[i]) / windowSec;
+        o["bytes_out_per_sec"] = (t.bytesOut - windowBytesOut[i]) / windowSec;
+        typeObj[messageTypeName(MessageType(i))] = o;
+    }
+
+    const TypeStats &blocks = types[int(MessageType::BlockReply)];
+    QJsonObject result;
+    result["window_ms"] = double(now - windowStartMs);
+    result["transfer_in_bytes_per_sec"] = (blocks.bytesIn - windowBytesIn[int(MessageType::BlockReply)]) / windowSec;
+    result["types"] = typeObj;
+
+    windowStartMs = now;
+    for (int i = 0; i < MESSAGE_TYPE_COUNT; ++i) {
+        windowBytesIn[i] = types[i].bytesIn;
+        windowBytesOut[i] = types[i].bytesOut;
+    }
+    return result;
+}
@@ -0,0 +1,97 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QSet>
+#include <array>
+#include "messagetypes.h"
+
+//per-datagram debug output; compiled out unless built with P2PAL_NET_TRACE, so the
+//arguments are not even evaluated on the hot path
+#ifdef P2PAL_NET_TRACE
+#define NET_TRACE() qDebug()
+#else
+#define NET_TRACE() if (true) {} else qDebug()
+#endif
+
+//counters for the networking layer; everything is plain integer updates on the receive
+//and send paths, aggregation only happens in snapshot() and rates()
+class NetworkMetrics {
+public:
+    enum DropReason { ParseError, HopLimit, Duplicate, UnknownType, NoRoute, DropReasonCount };
+
+    //log2 buckets of nanoseconds, bucket 0 is everything below 512ns
+    struct Histogram {
+        static constexpr int BUCKETS = 20;
+        std::array<quint64, BUCKETS> counts{};
+        quint64 total = 0;
+        quint64 sumNs = 0;
+        void record(qint64 ns);
+        double percentileUs(double p) const;
+    };
+
+    struct TypeStats {
+        quint64 messagesIn = 0;
+        quint64 batchedIn = 0;
+        quint64 bytesIn = 0;
+        quint64 messagesOut = 0;
+        quint64 bytesOut = 0;
+        Histogram handler;
+    };
+
+    struct PeerStats {
+        quint64 datagramsIn = 0;
+        quint64 bytesIn = 0;
+        quint64 datagramsOut = 0;
+        quint64 bytesOut = 0;
+        quint64 pingsSent = 0;
+        quint64 pongsReceived = 0;
+        double lastRttMs = -1;
+        double smoothedRttMs = -1;
+    };
+
+    NetworkMetrics();
+
+    void recordIn(MessageType type, const QHostAddress &peer, int bytes);
+    void recordBatchedIn(MessageType type);  //a message unpacked from a BATCH datagram
+    void recordOut(MessageType type, const QHostAddress &peer, int bytes);
+    void recordHandler(MessageType type, qint64 ns);
+    void recordDrop(DropReason reason);
+    void recordReceiveBatch(int datagrams);
+    void recordPing(const QHostAddress &peer);
+    void recordPong(const QHostAddress &peer, double rttMs);
+    void retainPeers(const QSet<QHostAddress> &keep);  //per-peer stats of everyone else are dropped
+
+    qint64 uptimeMs() const;
+    quint64 totalBytesIn() const { return bytesInTotal; }
+    quint64 totalBytesOut() const { return bytesOutTotal; }
+    quint64 totalDatagramsIn() const { return datagramsInTotal; }
+    quint64 totalDatagramsOut() const { return datagramsOutTotal; }
+
+    QJsonObject snapshot() const;
+    //bytes/sec since the previous rates() call; only the periodic dump calls it, so other
+    //readers of snapshot() do not shorten its window
+    QJsonObject rates();
+
+private:
+    QElapsedTimer clock;
+    std::array<TypeStats, MESSAGE_TYPE_COUNT> types;
+    std::array<quint64, DropReasonCount> drops{};
+    QHash<QHostAddress, PeerStats> peers;
+    quint64 bytesInTotal = 0;
+    quint64 bytesOutTotal = 0;
+    quint64 datagramsInTotal = 0;
+    quint64 datagramsOutTotal = 0;
+    int lastReceiveBatch = 0;
+    int maxReceiveBatch = 0;
+
+    qint64 windowStartMs = 0;
+    std::array<quint64, MESSAGE_TYPE_COUNT> windowBytesIn{};
+    std::array<quint64, MESSAGE_TYPE_COUNT> windowBytesOut{};
+};
+
+#endif
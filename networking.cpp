@@ -1,74 +1,495 @@
 #include "networking.h"
+#include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QJsonParseError>
+#include <QDateTime>
 #include <QDebug>
+#include <QFile>
 #include <QHostInfo>
+#include <QNetworkInterface>
+#include <QRandomGenerator>
 
+namespace {
+bool isWildcard(const QHostAddress &address) {
+    return address == QHostAddress::Any || address == QHostAddress::AnyIPv4 || address == QHostAddress::AnyIPv6;
+}
+}
 
-Networking::Networking(QObject *parent) : QObject(parent) {
+//the rumor sequence number starts from the wall clock, so a restarted node is not taken for a stale one
+Networking::Networking(QObject *parent)
+    : QObject(parent), rumorSeqNo(int(QDateTime::currentSecsSinceEpoch() / 60)) {
     udpSocket = new QUdpSocket(this);
-    udpSocket->bind(QHostAddress::Any, 0);
+    localNodeId = QHostInfo::localHostName();
+    receiveBuffer.reserve(64 * 1024);
+    registerHandlers();
+
+    batcher = new OutboundBatcher([this](const QByteArray &datagram, const QHostAddress &host, quint16 port, MessageType type) {
+        writeTo(datagram, host, port, type);
+    }, this);
+    batcher->setFlushWindow(DEFAULT_BATCH_WINDOW_MS);
+    batcher->setMtu(DEFAULT_BATCH_MTU);
+    batcher->setPiggyback([this](const QHostAddress &host, int room) {
+        return piggybackRouteRumor(host, room);
+    });
 
     connect(udpSocket, &QUdpSocket::readyRead, this, &Networking::handleIncomingDatagrams);
 
+    maintenanceTimer = new QTimer(this);
+    connect(maintenanceTimer, &QTimer::timeout, this, &Networking::maintainOverlay);
+    maintenanceTimer->start(MAINTENANCE_INTERVAL_MS);
+
+    antiEntropyTimer = new QTimer(this);
+    connect(antiEntropyTimer, &QTimer::timeout, this, &Networking::runAntiEntropy);
+    antiEntropyTimer->start(ANTI_ENTROPY_INTERVAL_MS);
+
     //send initial route rumor
     QTimer::singleShot(5000, this, &Networking::sendRouteRumor);
 }
 
 void Networking::handleIncomingDatagrams() {
-    processIncomingDatagrams(nullptr);
+    processIncomingDatagrams();
 }
 QSet<QHostAddress> Networking::getPeers() const {
-    return peers;
+    return membership.activeView();
+}
+
+QSet<QHostAddress> Networking::getPassivePeers() const {
+    return membership.passiveView();
+}
+
+void Networking::setViewSizes(int activeSize, int passiveSize) {
+    for (const QHostAddress &peer : membership.setSizes(activeSize, passiveSize)) {
+        disconnectFrom(peer);
+    }
+}
+
+//the bound port is also the port every peer is sent to, so all nodes must agree on it
+bool Networking::bind(const QHostAddress &address, quint16 port) {
+    udpSocket->close();
+    multicastJoined = false;
+    bool ok = udpSocket->bind(address, port);
+    if (!ok) {
+        qDebug() << "bind failed on" << address.toString() << port << ":" << udpSocket->errorString();
+        return false;
+    }
+    configuredPort = port;
+
+    localAddresses.clear();
+    if (isWildcard(address)) {
+        const QList<QHostAddress> all = QNetworkInterface::allAddresses();
+        for (const QHostAddress &local : all) localAddresses.insert(local);
+    } else {
+        localAddresses.insert(address);
+    }
+
+    if (discoveryTimer) joinMulticast();
+    return true;
+}
+
+//wildcard bind on the peer port; a second node on the same host still runs, but only on an ephemeral port
+bool Networking::listen(quint16 port) {
+    //no fallback to another port, other nodes only ever send to the shared one
+    if (bind(QHostAddress::AnyIPv4, port)) return true;
+    qWarning() << "peer port" << port << "is taken:" << udpSocket->errorString();
+    return false;
+}
+
+quint16 Networking::peerPort() const {
+    return configuredPort;
+}
+
+void Networking::setMulticastGroup(const QHostAddress &group) {
+    if (multicastJoined) udpSocket->leaveMulticastGroup(multicastGroup);
+    multicastJoined = false;
+    multicastGroup = group;
+    if (discoveryTimer) joinMulticast();
+}
+
+void Networking::joinMulticast() {
+    if (multicastGroup.isNull()) return;
+    multicastJoined = udpSocket->joinMulticastGroup(multicastGroup);
+    if (multicastJoined) {
+        udpSocket->setSocketOption(QAbstractSocket::MulticastTtlOption, 1);  //stay on the local network
+    } else {
+        qDebug() << "could not join multicast group" << multicastGroup.toString()
+                 << "- discovery falls back to broadcast:" << udpSocket->errorString();
+    }
+}
+
+//announce once, then again only while we still have no peers
+void Networking::startDiscovery() {
+    if (!discoveryTimer) {
+        discoveryTimer = new QTimer(this);
+        connect(discoveryTimer, &QTimer::timeout, this, [this]() {
+            if (membership.activeView().isEmpty()) broadcastDiscovery();
+        });
+    }
+    joinMulticast();
+    discoveryTimer->start(DISCOVERY_RETRY_MS);
+    broadcastDiscovery();
+}
+
+//shuffle: every interval one random neighbour gets a sample of our views and answers with a
+//sample of its own, which keeps the passive view fresh for repairs
+void Networking::startPeerExchange(int intervalMs) {
+    if (!exchangeTimer) {
+        exchangeTimer = new QTimer(this);
+        connect(exchangeTimer, &QTimer::timeout, this, &Networking::exchangeWithRandomPeer);
+    }
+    exchangeTimer->start(intervalMs);
+    for (const auto &peer : membership.activeView()) {
+        sendPeerExchange(peer, false);
+    }
+}
+
+void Networking::exchangeWithRandomPeer() {
+    QHostAddress peer = membership.randomActive();
+    if (!peer.isNull()) sendPeerExchange(peer, false);
+}
+
+void Networking::sendPeerExchange(const QHostAddress &peer, bool reply) {
+    QJsonArray sample;
+    for (const QHostAddress &known : membership.sample(PEER_EXCHANGE_SAMPLE, peer)) {
+        sample.append(known.toString());
+    }
+
+    QJsonObject msg;
+    msg.insert(QLatin1String("Type"), QLatin1String("PEER_EXCHANGE"));
+    msg.insert(QLatin1String("Origin"), localNodeId);
+    msg.insert(QLatin1String("Peers"), sample);
+    if (reply) msg.insert(QLatin1String("Reply"), true);
+    queueTo(QJsonDocument(msg).toJson(QJsonDocument::Compact), peer, configuredPort, MessageType::PeerExchange);
+}
+
+bool Networking::isLocalAddress(const QHostAddress &address) const {
+    return localAddresses.contains(address);
+}
+
+//peers we hear about start out as backups; with no neighbours yet the first one becomes our contact
+void Networking::learnPeer(const QHostAddress &peer) {
+    if (peer.isNull() || isLocalAddress(peer) || membership.isKnown(peer)) return;
+    NET_TRACE() << "🟢 New peer: " << peer.toString();
+    if (membership.activeView().isEmpty() && pendingNeighbors.isEmpty()) {
+        joinVia(peer);
+        return;
+    }
+    membership.addPassive(peer);
+    repairActiveView();
+}
+
+//overlay control messages skip the batcher, joins and repairs should not wait for a flush
+void Networking::sendOverlayMessage(const QHostAddress &peer, MessageType type, QJsonObject message) {
+    message.insert(QLatin1String("Type"), QLatin1String(messageTypeName(type)));
+    message.insert(QLatin1String("Origin"), localNodeId);
+    writeTo(QJsonDocument(message).toJson(QJsonDocument::Compact), peer, configuredPort, type);
+}
+
+void Networking::joinVia(const QHostAddress &contact) {
+    if (contact.isNull() || isLocalAddress(contact) || membership.isActive(contact)) return;
+    addNeighbor(contact);
+    sendOverlayMessage(contact, MessageType::Join);
+}
+
+//links are symmetric, so whoever is pushed out of a full active view is told to drop us too
+void Networking::addNeighbor(const QHostAddress &peer) {
+    bool firstNeighbor = membership.activeView().isEmpty();
+    QHostAddress evicted = membership.addActive(peer, metrics.uptimeMs());
+    if (firstNeighbor && membership.isActive(peer)) requestCatchUp(peer);  //(re)joining, fetch what we missed
+    if (!evicted.isNull()) {
+        disconnectFrom(evicted);
+        NET_TRACE() << "evicted neighbour " << evicted.toString() << " for " << peer.toString();
+    }
+}
+
+//for a neighbour we already moved out of the active view
+void Networking::disconnectFrom(const QHostAddress &peer) {
+    sendOverlayMessage(peer, MessageType::Disconnect);
+    lastRumorAt.remove(peer);
+}
+
+void Networking::requestNeighbor(const QHostAddress &peer, bool highPriority) {
+    pendingNeighbors.insert(peer, metrics.uptimeMs());
+    QJsonObject msg;
+    if (highPriority) msg.insert(QLatin1String("HighPriority"), true);
+    sendOverlayMessage(peer, MessageType::Neighbor, msg);
+}
+
+//fills free active slots from the passive view, one outstanding request per free slot;
+//exclude is a peer that just left us and should not be asked straight back
+void Networking::repairActiveView(const QHostAddress &exclude) {
+    int wanted = membership.activeCapacity() - int(membership.activeView().size()) - int(pendingNeighbors.size());
+    if (wanted <= 0) return;
+
+    QSet<QHostAddress> skip;
+    if (!exclude.isNull()) skip.insert(exclude);
+    for (auto it = pendingNeighbors.constBegin(); it != pendingNeighbors.constEnd(); ++it) skip.insert(it.key());
+    bool isolated = membership.activeView().isEmpty();
+    while (wanted-- > 0) {
+        QHostAddress candidate = membership.randomPassive(skip);
+        if (candidate.isNull()) break;
+        skip.insert(candidate);
+        requestNeighbor(candidate, isolated);
+    }
 }
-void Networking::sendDatagram(const QByteArray &datagram, int sequenceNumber) {
+
+//neighbours that missed several keepalives are dropped and replaced from the passive view;
+//the PINGs sent here are the keepalives and also feed the RTT metrics
+void Networking::maintainOverlay() {
+    qint64 now = metrics.uptimeMs();
+    for (const QHostAddress &peer : membership.silentPeers(now, FAILURE_TIMEOUT_MS)) {
+        membership.dropPeer(peer);
+        lastRumorAt.remove(peer);
+        qDebug() << "neighbour" << peer.toString() << "stopped responding";
+    }
+    for (auto it = pendingNeighbors.begin(); it != pendingNeighbors.end();) {
+        if (now - it.value() > NEIGHBOR_TIMEOUT_MS) {
+            membership.dropPeer(it.key());
+            it = pendingNeighbors.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    repairActiveView();
+    probePeers();
+
+    for (auto it = recentSearches.begin(); it != recentSearches.end();) {
+        if (now - it.value() >= SEARCH_DUPLICATE_MS) {
+            it = recentSearches.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    QSet<QHostAddress> known = membership.activeView();
+    known.unite(membership.passiveView());
+    metrics.retainPeers(known);
+}
+
+void Networking::setNodeId(const QString &id) {
+    localNodeId = id;
+}
+
+QString Networking::nodeId() const {
+    return localNodeId;
+}
+
+QMap<QString, QPair<QHostAddress, quint16>> Networking::getRoutingTable() const {
+    return routingTable;
+}
+
+void Networking::setLinkImpairment(double lossRate, int delayMs, quint32 seed) {
+    impairLossRate = lossRate;
+    impairDelayMs = delayMs;
+    impairRng.seed(seed);
+}
+
+quint64 Networking::getBytesSent() const {
+    return metrics.totalBytesOut();
+}
+
+quint64 Networking::getBytesReceived() const {
+    return metrics.totalBytesIn();
+}
+
+quint64 Networking::getDatagramsSent() const {
+    return metrics.totalDatagramsOut();
+}
+
+quint64 Networking::getDatagramsReceived() const {
+    return metrics.totalDatagramsIn();
+}
+
+void Networking::setStatsDump(const QString &path, int intervalMs) {
+    statsPath = path;
+    if (!statsTimer) {
+        statsTimer = new QTimer(this);
+        connect(statsTimer, &QTimer::timeout, this, &Networking::dumpStats);
+    }
+    if (intervalMs > 0) {
+        statsTimer->start(intervalMs);
+    } else {
+        statsTimer->stop();
+    }
+}
+
+QJsonObject Networking::statsSnapshot() {
+    QJsonObject snap = metrics.snapshot();
+    snap["node"] = localNodeId;
+
+    QJsonObject queues;
+    queues["message_buffer"] = messageBuffer.size();
+    queues["peers"] = membership.activeView().size();
+    queues["passive_peers"] = membership.passiveView().size();
+    queues["pending_neighbors"] = pendingNeighbors.size();
+    queues["multicast"] = multicastJoined;
+    queues["routes"] = routingTable.size();
+    queues["batch_pending"] = batcher->pendingMessages();
+    snap["queues"] = queues;
+
+    QJsonObject batching;
+    batching["window_ms"] = batcher->flushWindow();
+    batching["mtu"] = batcher->mtu();
+    batching["batches_sent"] = double(batcher->batchesSent());
+    batching["messages_batched"] = double(batcher->messagesBatched());
+    snap["batching"] = batching;
+
+    if (history.isOpen()) {
+        QJsonObject stored;
+        stored["segments"] = history.segmentCount();
+        stored["records"] = history.recordCount();
+        stored["bytes"] = double(history.sizeOnDisk());
+        snap["history"] = stored;
+    }
+    return snap;
+}
+
+//one JSON object per line, so the dump file can be tailed or loaded as JSONL
+void Networking::dumpStats() {
+    probePeers();
+    QJsonObject snap = statsSnapshot();
+    snap["rates"] = metrics.rates();
+    QByteArray line = QJsonDocument(snap).toJson(QJsonDocument::Compact);
+    if (statsPath.isEmpty()) {
+        qInfo().noquote() << "stats" << QString::fromUtf8(line);
+        return;
+    }
+    QFile file(statsPath);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        file.write(line + '\n');
+    }
+}
+
+//PING carries the sender's clock so the PONG gives the round trip without per-peer state
+void Networking::probePeers() {
+    QVariantMap ping;
+    ping["Type"] = "PING";
+    ping["Origin"] = localNodeId;
+    ping["Nonce"] = double(metrics.uptimeMs());
+    QByteArray datagram = QJsonDocument(QJsonObject::fromVariantMap(ping)).toJson(QJsonDocument::Compact);
+
+    for (const auto &peer : membership.activeView()) {
+        metrics.recordPing(peer);
+        writeTo(datagram, peer, configuredPort, MessageType::Ping);
+    }
+}
+
+void Networking::setBatching(int flushWindowMs, int mtu) {
+    batcher->setFlushWindow(flushWindowMs);
+    batcher->setMtu(mtu);
+}
+
+//small peer-to-peer messages go through the batcher and may share a datagram
+void Networking::queueTo(const QByteArray &message, const QHostAddress &host, quint16 port, MessageType type) {
+    batcher->enqueue(message, host, port, type);
+}
+
+//every outgoing datagram goes through here so counters and link impairment apply uniformly
+void Networking::writeTo(const QByteArray &datagram, const QHostAddress &host, quint16 port, MessageType type) {
+    metrics.recordOut(type, host, datagram.size());
+
+    if (impairLossRate > 0.0 && impairRng.generateDouble() < impairLossRate) {
+        return;
+    }
+    if (impairDelayMs > 0) {
+        QTimer::singleShot(impairDelayMs, this, [this, datagram, host, port]() {
+            udpSocket->writeDatagram(datagram, host, port);
+        });
+        return;
+    }
+    udpSocket->writeDatagram(datagram, host, port);
+}
+void Networking::sendDatagram(const QByteArray &datagram, int sequenceNumber, MessageType type) {
     messageBuffer[sequenceNumber] = datagram;
-    for (const auto &peer : peers) {
-        udpSocket->writeDatagram(datagram, peer, 45454);
+    while (messageBuffer.size() > MESSAGE_BUFFER_LIMIT) messageBuffer.erase(messageBuffer.begin());
+
+    for (const auto &peer : membership.activeView()) {
+        queueTo(datagram, peer, configuredPort, type);
     }
 }
+//our own chat: clock and history are updated from the fields here, before encoding;
+//a hopLimit of 0 leaves HopLimit out, so only direct neighbours get it
+int Networking::sendChat(const QString &chatText, int hopLimit) {
+    int seq = sequenceNumber++;
+    vectorClock.updateClock(localNodeId, seq);  //our own messages coming back are duplicates
+    history.append(localNodeId, seq, chatText);
+
+    QJsonObject msg;
+    msg.insert(QLatin1String("Type"), QLatin1String("CHAT"));
+    msg.insert(QLatin1String("Origin"), localNodeId);
+    msg.insert(QLatin1String("SequenceNumber"), seq);
+    msg.insert(QLatin1String("ChatText"), chatText);
+    if (hopLimit > 0) msg.insert(QLatin1String("HopLimit"), hopLimit);
+    sendDatagram(QJsonDocument(msg).toJson(QJsonDocument::Compact), seq, MessageType::Chat);
+    return seq;
+}
+
 void Networking::broadcastDiscovery() {
-    qDebug() << "Broadcasting peer discovery...";
+    qDebug() << "Broadcasting peer discovery..." << (multicastJoined ? multicastGroup.toString() : QString("broadcast"));
 
     QVariantMap discoveryMap;
     discoveryMap["Type"] = "DISCOVERY";
+    discoveryMap["Origin"] = localNodeId;
 
-    QByteArray discoveryMessage = QJsonDocument(QJsonObject::fromVariantMap(discoveryMap)).toJson();
+    QByteArray discoveryMessage = QJsonDocument(QJsonObject::fromVariantMap(discoveryMap)).toJson(QJsonDocument::Compact);
 
-    udpSocket->writeDatagram(discoveryMessage, QHostAddress::Broadcast, 45454);
+    QHostAddress target = multicastJoined ? multicastGroup : QHostAddress(QHostAddress::Broadcast);
+    writeTo(discoveryMessage, target, configuredPort, MessageType::Discovery);
 }
 void Networking::runGossip() {
-    qDebug() << "running Gossip Protocol...";
+    NET_TRACE() << "running Gossip Protocol...";
 
-    for (const auto &peer : peers) {
+    for (const auto &peer : membership.activeView()) {
         for (auto it = messageBuffer.begin(); it != messageBuffer.end(); ++it) {
             QByteArray gossipMessage = it.value();
-            udpSocket->writeDatagram(gossipMessage, peer, 45454);
-            qDebug() << "📡Gossip message sent to " << peer.toString();
+            queueTo(gossipMessage, peer, configuredPort, MessageType::Chat);
+            NET_TRACE() << "📡Gossip message sent to " << peer.toString();
         }
     }
 }
 
 void Networking::forwardMessage(const QByteArray &datagram, const QHostAddress &sender) {
-    QJsonDocument doc = QJsonDocument::fromJson(datagram);
-    QVariantMap messageMap = doc.object().toVariantMap();
-
-    if (messageMap.contains("HopLimit")) {
-        int hopLimit = messageMap["HopLimit"].toInt();
-        if (hopLimit > 0) {
-            messageMap["HopLimit"] = hopLimit - 1;
-            QByteArray newDatagram = QJsonDocument(QJsonObject::fromVariantMap(messageMap)).toJson();
-            for (const auto &peer : peers) {
-                if (peer != sender) {
-                    udpSocket->writeDatagram(newDatagram, peer, 45454);
-                }
+    QJsonObject message = QJsonDocument::fromJson(datagram).object();
+    forwardObject(message, messageTypeOf(message), sender);
+}
+
+void Networking::forwardObject(QJsonObject message, MessageType type, const QHostAddress &sender) {
+    const QJsonValue hop = message.value(QLatin1String("HopLimit"));
+    if (hop.isUndefined()) return;
+
+    int hopLimit = hop.toInt();
+    if (hopLimit > 0) {
+        message.insert(QLatin1String("HopLimit"), hopLimit - 1);
+        QByteArray newDatagram = QJsonDocument(message).toJson(QJsonDocument::Compact);
+        for (const auto &peer : membership.activeView()) {
+            if (peer != sender) {
+                queueTo(newDatagram, peer, configuredPort, type);
             }
-        } else {
-            qDebug() << "message discarded: Hop limit reached.";
         }
+    } else {
+        metrics.recordDrop(NetworkMetrics::HopLimit);
+        NET_TRACE() << "message discarded: Hop limit reached.";
     }
 }
 
+//hop by hop along the DSDV routes; a route that points back at the sender would only bounce
+void Networking::relayToDestination(QJsonObject message, MessageType type, const QString &dest, const QHostAddress &sender) {
+    const QJsonValue hop = message.value(QLatin1String("HopLimit"));
+    int hopLimit = hop.isUndefined() ? ROUTED_HOP_LIMIT : hop.toInt();
+    if (hopLimit <= 0) {
+        metrics.recordDrop(NetworkMetrics::HopLimit);
+        return;
+    }
+    auto route = routingTable.constFind(dest);
+    if (route == routingTable.constEnd() || route->first == sender) {
+        metrics.recordDrop(NetworkMetrics::NoRoute);
+        NET_TRACE() << "no route to pass on message for" << dest;
+        return;
+    }
+    message.insert(QLatin1String("HopLimit"), hopLimit - 1);
+    writeTo(QJsonDocument(message).toJson(QJsonDocument::Compact), route->first, route->second, type);
+}
+
 void Networking::setNoForwardMode(bool mode) {
     noforwardMode = mode;
     qDebug() << "No-Forward Mode set to:" << mode;
@@ -76,146 +497,523 @@ void Networking::setNoForwardMode(bool mode) {
 
 
 
-void Networking::processIncomingDatagrams(QTextEdit *chatLog) {
+void Networking::registerHandlers() {
+    dispatcher.registerHandler<ChatMessage>([this](const ChatMessage &msg, const IncomingMessage &in) {
+        handleChat(msg, in);
+    });
+    dispatcher.registerHandler(MessageType::Discovery, [this](const IncomingMessage &in) {
+        handleDiscovery(in);
+    });
+    dispatcher.registerHandler(MessageType::DiscoveryResponse, [this](const IncomingMessage &in) {
+        handleDiscoveryResponse(in);
+    });
+    dispatcher.registerHandler<PrivateChatMessage>([this](const PrivateChatMessage &msg, const IncomingMessage &in) {
+        handlePrivateMessage(msg, in);
+    });
+    dispatcher.registerHandler<RouteRumorMessage>([this](const RouteRumorMessage &msg, const IncomingMessage &in) {
+        handleRouteRumor(msg, in);
+    });
+    dispatcher.registerHandler(MessageType::Ping, [this](const IncomingMessage &in) {
+        handlePing(in);
+    });
+    dispatcher.registerHandler(MessageType::Pong, [this](const IncomingMessage &in) {
+        handlePong(in);
+    });
+    dispatcher.registerHandler(MessageType::StatsRequest, [this](const IncomingMessage &in) {
+        handleStatsRequest(in);
+    });
+    dispatcher.registerHandler(MessageType::Batch, [this](const IncomingMessage &in) {
+        handleBatch(in);
+    });
+    dispatcher.registerHandler<PeerExchangeMessage>([this](const PeerExchangeMessage &msg, const IncomingMessage &in) {
+        handlePeerExchange(msg, in);
+    });
+    dispatcher.registerHandler(MessageType::Join, [this](const IncomingMessage &in) {
+        handleJoin(in);
+    });
+    dispatcher.registerHandler<ForwardJoinMessage>([this](const ForwardJoinMessage &msg, const IncomingMessage &in) {
+        handleForwardJoin(msg, in);
+    });
+    dispatcher.registerHandler<NeighborMessage>([this](const NeighborMessage &msg, const IncomingMessage &in) {
+        handleNeighbor(msg, in);
+    });
+    dispatcher.registerHandler<NeighborReplyMessage>([this](const NeighborReplyMessage &msg, const IncomingMessage &in) {
+        handleNeighborReply(msg, in);
+    });
+    dispatcher.registerHandler(MessageType::Disconnect, [this](const IncomingMessage &in) {
+        handleDisconnect(in);
+    });
+    dispatcher.registerHandler(MessageType::CatchUpRequest, [this](const IncomingMessage &in) {
+        handleCatchUpRequest(in);
+    });
+    dispatcher.registerHandler(MessageType::CatchUpDone, [this](const IncomingMessage &in) {
+        handleCatchUpDone(in);
+    });
+
+    //file sharing and search are handled by MainWindow; replies and requests for other nodes
+    //are passed on towards their Dest
+    dispatcher.registerHandler<FileRequestMessage>([this](const FileRequestMessage &msg, const IncomingMessage &in) {
+        if (!msg.dest.isEmpty() && msg.dest != localNodeId) {
+            relayToDestination(in.json, in.type, msg.dest, in.sender);
+            return;
+        }
+        emit fileRequestReceived(msg);
+    });
+    dispatcher.registerHandler<BlockReplyMessage>([this](const BlockReplyMessage &msg, const IncomingMessage &in) {
+        if (!msg.dest.isEmpty() && msg.dest != localNodeId) {
+            relayToDestination(in.json, in.type, msg.dest, in.sender);
+            return;
+        }
+        emit blockReplyReceived(msg);
+    });
+    dispatcher.registerHandler<SearchRequestMessage>([this](const SearchRequestMessage &msg, const IncomingMessage &in) {
+        handleSearchRequest(msg, in);
+    });
+    dispatcher.registerHandler<SearchResponseMessage>([this](const SearchResponseMessage &msg, const IncomingMessage &in) {
+        if (!msg.dest.isEmpty() && msg.dest != localNodeId) {
+            relayToDestination(in.json, in.type, msg.dest, in.sender);
+            return;
+        }
+        emit searchReplyReceived(msg);
+    });
+}
+
+void Networking::processIncomingDatagrams() {
+    QHostAddress sender;
+    quint16 senderPort = 0;
+    int drained = 0;
+
     while (udpSocket->hasPendingDatagrams()) {
-        QByteArray datagram;
-        QHostAddress sender;
-        quint16 senderPort;
-        datagram.resize(udpSocket->pendingDatagramSize());
-        udpSocket->readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
-
-        qDebug() << "Received datagram from:" << sender.toString()
-                 << "| Port: " << senderPort
-                 << "| Data: " << datagram;
-
-        QJsonDocument doc = QJsonDocument::fromJson(datagram);
-        if (doc.isNull()) {
-            qDebug() << "❌ Error parsing JSON!";
+        qint64 pending = udpSocket->pendingDatagramSize();
+        receiveBuffer.resize(qMax<qint64>(pending, 0));
+        qint64 size = udpSocket->readDatagram(receiveBuffer.data(), receiveBuffer.size(), &sender, &senderPort);
+        if (size < 0) break;
+        receiveBuffer.resize(size);
+        drained++;
+        membership.heard(sender, metrics.uptimeMs());
+
+        QElapsedTimer handlerTimer;
+        handlerTimer.start();
+
+        NET_TRACE() << "Received datagram from:" << sender.toString()
+                    << "| Port: " << senderPort
+                    << "| Data: " << receiveBuffer;
+
+        QJsonParseError parseError;
+        QJsonDocument doc = QJsonDocument::fromJson(receiveBuffer, &parseError);
+        if (parseError.error != QJsonParseError::NoError || !doc.isObject()) {
+            metrics.recordIn(MessageType::Unknown, sender, int(size));
+            metrics.recordDrop(NetworkMetrics::ParseError);
+            NET_TRACE() << "❌ Error parsing JSON!";
             continue;
         }
 
+        const QJsonObject json = doc.object();
+        MessageType type = messageTypeOf(json);
+        metrics.recordIn(type, sender, int(size));
+        NET_TRACE() << "Message Type: " << messageTypeName(type);
 
-        QVariantMap messageMap = doc.object().toVariantMap();
-        QString type = messageMap["Type"].toString();
-        qDebug() << "Message Type: " << type;
+        if (!dispatcher.dispatch({type, json, sender, senderPort, int(size)})) {
+            metrics.recordDrop(NetworkMetrics::UnknownType);
+        }
+        metrics.recordHandler(type, handlerTimer.nsecsElapsed());
+    }
+    if (drained > 0) metrics.recordReceiveBatch(drained);
+}
 
-        if (type == "CHAT") {
-            QString origin = messageMap["Origin"].toString();
-            int seqNum = messageMap["SequenceNumber"].toInt();
-            QString chatText = messageMap["ChatText"].toString();
+void Networking::handleChat(const ChatMessage &msg, const IncomingMessage &in) {
+    NET_TRACE() << " Chat Message Received: " << msg.chatText
+                << "| Origin: " << msg.origin
+                << "| SeqNum: " << msg.sequenceNumber;
 
-            qDebug() << " Chat Message Received: " << chatText
-                     << "| Origin: " << origin
-                     << "| SeqNum: " << seqNum;
+    //history records carry no HopLimit: a catch-up replay says nothing about the path to its origin
+    if (msg.hopLimit >= 0) updateRoutingTable(msg.origin, in.sender, in.senderPort, 0);
 
-            if (vectorClock.isNewMessage(origin, seqNum)) {
-                vectorClock.updateClock(origin, seqNum);
-                if (chatLog) chatLog->append(origin + ": " + chatText);
-                qDebug() << "message displayed in chat: " << chatText;
-            } else {
-                qDebug() << "duplicate message ignored.";
-            }
+    //only new messages are passed on, otherwise copies keep circulating around overlay cycles
+    if (vectorClock.isNewMessage(msg.origin, msg.sequenceNumber)) {
+        vectorClock.updateClock(msg.origin, msg.sequenceNumber);
+        history.append(msg.origin, msg.sequenceNumber, msg.chatText);
+        emit chatMessageReceived(msg.origin, msg.sequenceNumber, msg.chatText);
+        NET_TRACE() << "message displayed in chat: " << msg.chatText;
+        forwardObject(in.json, in.type, in.sender);
+    } else {
+        metrics.recordDrop(NetworkMetrics::Duplicate);
+        NET_TRACE() << "duplicate message ignored.";
+    }
+}
 
-            updateRoutingTable(origin, sender, senderPort, messageMap);
-            forwardMessage(datagram, sender);
+void Networking::handleDiscovery(const IncomingMessage &in) {
+    if (isLocalAddress(in.sender)) return;  //our own announcement looped back by the multicast group
+    learnPeer(in.sender);
 
-        } else if (type == "DISCOVERY") {
-            if (!peers.contains(sender)) {
-                peers.insert(sender);
-                qDebug() << "🟢 New peer discovered: " << sender.toString();
-            }
+    //the newcomer needs one contact, not an answer from every node on the segment; full nodes
+    //mostly stay quiet and leave the rest to PEER_EXCHANGE, the announcement repeats until someone answers
+    if (membership.activeFull() && QRandomGenerator::global()->bounded(DISCOVERY_FULL_REPLY_ODDS) != 0) return;
 
+    QVariantMap response;
+    response["Type"] = "DISCOVERY_RESPONSE";
+    response["Origin"] = localNodeId;
+    QByteArray responseData = QJsonDocument(QJsonObject::fromVariantMap(response)).toJson(QJsonDocument::Compact);
+    writeTo(responseData, in.sender, in.senderPort, MessageType::DiscoveryResponse);
+    NET_TRACE() << "Sent DISCOVERY_RESPONSE to " << in.sender.toString();
+}
 
-            QVariantMap response;
-            response["Type"] = "DISCOVERY_RESPONSE";
-            QByteArray responseData = QJsonDocument(QJsonObject::fromVariantMap(response)).toJson();
-            udpSocket->writeDatagram(responseData, sender, senderPort);
-            qDebug() << "Sent DISCOVERY_RESPONSE to " << sender.toString();
+//the first responder becomes our contact, the rest are kept as backups
+void Networking::handleDiscoveryResponse(const IncomingMessage &in) {
+    learnPeer(in.sender);
+}
 
-        } else if (type == "DISCOVERY_RESPONSE") {
-            if (!peers.contains(sender)) {
-                peers.insert(sender);
-                qDebug() << "added new peer from response: " << sender.toString();
-            }
+void Networking::handlePrivateMessage(const PrivateChatMessage &msg, const IncomingMessage &in) {
+    if (msg.dest == localNodeId) {
+        emit privateMessageReceived(msg.origin, msg.chatText);
+        NET_TRACE() << "received private message: " << msg.chatText;
+    } else {
+        NET_TRACE() << "forwarding private message to " << msg.dest << " with hop limit: " << msg.hopLimit;
+        relayToDestination(in.json, in.type, msg.dest, in.sender);
+    }
+}
 
-        } else if (type == "PRIVATE_MESSAGE") {
-            QString dest = messageMap["Dest"].toString();
-            QString privateMessage = messageMap["ChatText"].toString();
-            int hopLimit = messageMap["HopLimit"].toInt();
-
-            if (dest == QHostInfo::localHostName()) {
-                if (chatLog) chatLog->append("🔒 Private: " + privateMessage);
-                qDebug() << "received private message: " << privateMessage;
-            } else if (hopLimit > 0) {
-                messageMap["HopLimit"] = hopLimit - 1;
-                sendDatagram(QJsonDocument(QJsonObject::fromVariantMap(messageMap)).toJson(), sequenceNumber++);
-                qDebug() << "forwarding private message to " << dest << " with hop limit: " << hopLimit;
-            }
+//DSDV: a rumor is passed on to the other neighbours only when it changed our route, so every
+//node learns a route to every origin while each rumor crosses a link at most once per SeqNo
+void Networking::handleRouteRumor(const RouteRumorMessage &msg, const IncomingMessage &in) {
+    if (msg.origin == localNodeId) return;
+    bool changed = msg.hasLastAddress
+                       ? updateRoutingTable(msg.origin, in.sender, in.senderPort, msg.seqNo, msg.lastIP, msg.lastPort)
+                       : updateRoutingTable(msg.origin, in.sender, in.senderPort, msg.seqNo);
+    if (!changed) return;
+    NET_TRACE() << "updated route for: " << msg.origin << " via " << in.sender.toString();
 
-        } else if (type == "ROUTE_RUMOR") {
-            QString origin = messageMap["Origin"].toString();
-            updateRoutingTable(origin, sender, senderPort, messageMap);
-            qDebug() << "updated route for: " << origin << " via " << sender.toString();
-        }
-        type = messageMap["Type"].toString();
+    QByteArray relayed = QJsonDocument(in.json).toJson(QJsonDocument::Compact);
+    for (const auto &peer : membership.activeView()) {
+        if (peer != in.sender) queueTo(relayed, peer, configuredPort, MessageType::RouteRumor);
+    }
+}
 
+void Networking::handlePing(const IncomingMessage &in) {
+    QJsonObject pong;
+    pong.insert(QLatin1String("Type"), QLatin1String("PONG"));
+    pong.insert(QLatin1String("Origin"), localNodeId);
+    pong.insert(QLatin1String("Nonce"), in.json.value(QLatin1String("Nonce")));
+    writeTo(QJsonDocument(pong).toJson(QJsonDocument::Compact), in.sender, in.senderPort, MessageType::Pong);
+}
 
-        if (type == "FILE_REQUEST") {
-            emit fileRequestReceived(messageMap);
-        } else if (type == "BLOCK_REPLY") {
-            emit blockReplyReceived(messageMap);
-        }
-        if (type == "SEARCH_RESPONSE") {
-            emit searchReplyReceived(messageMap);
+void Networking::handlePong(const IncomingMessage &in) {
+    metrics.recordPong(in.sender, metrics.uptimeMs() - in.json.value(QLatin1String("Nonce")).toDouble());
+}
+
+//local stats endpoint: only answered for tools on the same host
+void Networking::handleStatsRequest(const IncomingMessage &in) {
+    if (!in.sender.isLoopback()) return;
+    QJsonObject reply;
+    reply["Type"] = "STATS";
+    reply["Stats"] = statsSnapshot();
+    writeTo(QJsonDocument(reply).toJson(QJsonDocument::Compact), in.sender, in.senderPort, MessageType::Stats);
+}
+
+//each message in a BATCH is dispatched and timed as if it had arrived on its own; the BATCH
+//histogram covers the whole datagram
+void Networking::handleBatch(const IncomingMessage &in) {
+    const QJsonArray messages = in.json.value(QLatin1String("Messages")).toArray();
+    QElapsedTimer handlerTimer;
+    for (const QJsonValue &value : messages) {
+        handlerTimer.start();
+        const QJsonObject json = value.toObject();
+        MessageType type = messageTypeOf(json);
+        if (type == MessageType::Batch) continue;  //batches do not nest
+        metrics.recordBatchedIn(type);
+        if (!dispatcher.dispatch({type, json, in.sender, in.senderPort, 0})) {
+            metrics.recordDrop(NetworkMetrics::UnknownType);
         }
+        metrics.recordHandler(type, handlerTimer.nsecsElapsed());
+    }
+}
+
+//answered locally, then what is left of the budget is split over the other neighbours
+void Networking::handleSearchRequest(const SearchRequestMessage &msg, const IncomingMessage &in) {
+    if (msg.origin == localNodeId) return;
+    QString key = msg.origin + '\n' + msg.search;
+    qint64 now = metrics.uptimeMs();
+    auto seen = recentSearches.constFind(key);
+    if (seen != recentSearches.constEnd() && now - seen.value() < SEARCH_DUPLICATE_MS) {
+        metrics.recordDrop(NetworkMetrics::Duplicate);
+        return;
+    }
+    recentSearches.insert(key, now);
+
+    emit searchRequestReceived(msg);
+    forwardSearch(in.json, msg.budget - 1, msg.hopLimit - 1, in.sender);
+}
 
+//up to budget random neighbours each get an even share of the budget
+void Networking::forwardSearch(QJsonObject message, int budget, int hopLimit, const QHostAddress &sender) {
+    if (budget <= 0) return;
+    if (hopLimit <= 0) {
+        metrics.recordDrop(NetworkMetrics::HopLimit);
+        return;
+    }
+    QList<QHostAddress> targets;
+    for (const auto &peer : membership.activeView()) {
+        if (peer != sender) targets << peer;
+    }
+    int count = qMin(int(targets.size()), budget);
+    for (int i = 0; i < count; ++i) {
+        targets.swapItemsAt(i, i + QRandomGenerator::global()->bounded(int(targets.size()) - i));
+    }
 
+    message.insert(QLatin1String("HopLimit"), hopLimit);
+    for (int i = 0; i < count; ++i) {
+        message.insert(QLatin1String("Budget"), budget / count + (i < budget % count ? 1 : 0));
+        queueTo(QJsonDocument(message).toJson(QJsonDocument::Compact), targets[i], configuredPort,
+                MessageType::SearchRequest);
     }
 }
 
+void Networking::handlePeerExchange(const PeerExchangeMessage &msg, const IncomingMessage &in) {
+    learnPeer(in.sender);
+    for (const QString &address : msg.peers) {
+        learnPeer(QHostAddress(address));
+    }
+    if (!msg.reply) sendPeerExchange(in.sender, true);
+}
 
+//the contact takes the new node as a neighbour and sends it on random walks so that other
+//nodes pick it up as well
+void Networking::handleJoin(const IncomingMessage &in) {
+    if (isLocalAddress(in.sender)) return;
+    addNeighbor(in.sender);
 
-void Networking::sendRouteRumor() {
+    QJsonObject walk;
+    walk.insert(QLatin1String("NewNode"), in.sender.toString());
+    walk.insert(QLatin1String("TTL"), ACTIVE_WALK_LENGTH);
+    for (const auto &peer : membership.activeView()) {
+        if (peer != in.sender) sendOverlayMessage(peer, MessageType::ForwardJoin, walk);
+    }
+}
+
+void Networking::handleForwardJoin(const ForwardJoinMessage &msg, const IncomingMessage &in) {
+    QHostAddress newNode(msg.newNode);
+    if (newNode.isNull() || isLocalAddress(newNode) || membership.isActive(newNode)) return;
+
+    //the new node already has its contact, so the offer is high priority only if we are isolated
+    bool isolated = membership.activeView().isEmpty();
+    if (msg.ttl <= 0 || membership.activeView().size() <= 1) {
+        requestNeighbor(newNode, isolated);
+        return;
+    }
+    if (msg.ttl == PASSIVE_WALK_LENGTH) membership.addPassive(newNode);
+
+    QHostAddress next = membership.randomActive({in.sender, newNode});
+    if (next.isNull()) {
+        requestNeighbor(newNode, isolated);
+        return;
+    }
+    QJsonObject walk;
+    walk.insert(QLatin1String("NewNode"), msg.newNode);
+    walk.insert(QLatin1String("TTL"), msg.ttl - 1);
+    sendOverlayMessage(next, MessageType::ForwardJoin, walk);
+}
+
+//a node with no neighbours at all asks with high priority and is never turned away
+void Networking::handleNeighbor(const NeighborMessage &msg, const IncomingMessage &in) {
+    if (isLocalAddress(in.sender)) return;
+    bool accept = msg.highPriority || !membership.activeFull() || membership.isActive(in.sender);
+    if (accept) {
+        addNeighbor(in.sender);
+    } else {
+        membership.addPassive(in.sender);
+    }
+
+    QJsonObject reply;
+    reply.insert(QLatin1String("Accepted"), accept);
+    sendOverlayMessage(in.sender, MessageType::NeighborReply, reply);
+}
+
+void Networking::handleNeighborReply(const NeighborReplyMessage &msg, const IncomingMessage &in) {
+    pendingNeighbors.remove(in.sender);
+    if (msg.accepted) {
+        addNeighbor(in.sender);
+    } else {
+        repairActiveView(in.sender);  //not the peer that just refused, maintainOverlay may try it again later
+    }
+}
+
+//serves everything newer than the requester's clock from the on-disk log, oldest first per origin
+//so the requester's vector clock accepts each message in turn. Only origins in the request's
+//[From, Until) name range are served, and only to peers in our views
+void Networking::handleCatchUpRequest(const IncomingMessage &in) {
+    if (!history.isOpen() || !membership.isKnown(in.sender)) return;
+    const QJsonObject have = in.json.value(QLatin1String("Have")).toObject();
+    const QString from = in.json.value(QLatin1String("From")).toString();
+    const QString until = in.json.value(QLatin1String("Until")).toString();
+
+    int budget = CATCHUP_MAX_MESSAGES;
+    qint64 bytes = CATCHUP_MAX_BYTES;
+    bool more = false;
+    for (const QString &origin : history.origins()) {
+        if (origin < from || (!until.isEmpty() && origin >= until)) continue;
+        int after = have.value(origin).toInt();
+        if (history.lastSequence(origin) <= after) continue;
+        if (budget == 0 || bytes <= 0) {
+            more = true;
+            break;
+        }
+        const QList<QByteArray> records = history.range(origin, after, budget + 1);  //one extra tells us if more remain
+        int served = 0;
+        while (served < records.size() && served < budget && bytes > 0) {
+            queueTo(records[served], in.sender, in.senderPort, MessageType::Chat);
+            bytes -= records[served].size();
+            ++served;
+        }
+        budget -= served;
+        if (records.size() > served) {
+            more = true;
+            break;
+        }
+    }
+
+    QJsonObject done;
+    done.insert(QLatin1String("Type"), QLatin1String("CATCHUP_DONE"));
+    done.insert(QLatin1String("Origin"), localNodeId);
+    done.insert(QLatin1String("More"), more);
+    if (!from.isEmpty()) done.insert(QLatin1String("From"), from);
+    if (!until.isEmpty()) done.insert(QLatin1String("Until"), until);
+    queueTo(QJsonDocument(done).toJson(QJsonDocument::Compact), in.sender, in.senderPort, MessageType::CatchUpDone);
+}
+
+//only the slice that still has more is asked for again
+void Networking::handleCatchUpDone(const IncomingMessage &in) {
+    if (!in.json.value(QLatin1String("More")).toBool()) return;
+    requestCatchUp(in.sender, in.json.value(QLatin1String("From")).toString(),
+                   in.json.value(QLatin1String("Until")).toString());
+}
+
+void Networking::handleDisconnect(const IncomingMessage &in) {
+    if (membership.removeActive(in.sender)) {
+        lastRumorAt.remove(in.sender);
+        repairActiveView(in.sender);
+    }
+}
+
+QByteArray Networking::encodeRouteRumor() const {
     QVariantMap msg;
     msg["Type"] = "ROUTE_RUMOR";
-    msg["Origin"] = QHostInfo::localHostName();
-    msg["SeqNo"] = vectorClock.getClock()[msg["Origin"].toString()] + 1;
-    msg["LastIP"] = udpSocket->localAddress().toString();
-    msg["LastPort"] = udpSocket->localPort();
+    msg["Origin"] = localNodeId;
+    msg["SeqNo"] = rumorSeqNo;
+    if (!isWildcard(udpSocket->localAddress())) {  //a wildcard bind has no address worth advertising
+        msg["LastIP"] = udpSocket->localAddress().toString();
+        msg["LastPort"] = udpSocket->localPort();
+    }
+    return QJsonDocument(QJsonObject::fromVariantMap(msg)).toJson(QJsonDocument::Compact);
+}
 
-    QByteArray datagram = QJsonDocument(QJsonObject::fromVariantMap(msg)).toJson();
-    for (const auto &peer : peers) {
-        udpSocket->writeDatagram(datagram, peer, 45454);
+//rides along with chat batches; peers that got one recently are skipped by the periodic rumor
+QByteArray Networking::piggybackRouteRumor(const QHostAddress &host, int room) {
+    qint64 now = metrics.uptimeMs();
+    auto it = lastRumorAt.constFind(host);
+    if (it != lastRumorAt.constEnd() && now - it.value() < ROUTE_RUMOR_PIGGYBACK_MS) return QByteArray();
+
+    QByteArray rumor = encodeRouteRumor();
+    if (rumor.size() > room) return QByteArray();
+    lastRumorAt[host] = now;
+    return rumor;
+}
+
+//each periodic rumor carries a new sequence number, so it spreads through the whole overlay again
+void Networking::sendRouteRumor() {
+    rumorSeqNo = qMax(rumorSeqNo + 1, int(QDateTime::currentSecsSinceEpoch() / 60));
+    QByteArray datagram = encodeRouteRumor();
+    qint64 now = metrics.uptimeMs();
+    for (const auto &peer : membership.activeView()) {
+        auto it = lastRumorAt.constFind(peer);
+        if (it != lastRumorAt.constEnd() && now - it.value() < ROUTE_RUMOR_PIGGYBACK_MS) continue;
+        lastRumorAt[peer] = now;
+        queueTo(datagram, peer, configuredPort, MessageType::RouteRumor);
     }
     QTimer::singleShot(60000, this, &Networking::sendRouteRumor);
 }
 
+//a manually added peer is used as a contact to join the overlay through
 void Networking::addPeer(const QHostAddress &peer) {
-    if (!peers.contains(peer)) {
-        peers.insert(peer);
+    if (!membership.isActive(peer)) {
         qDebug() << "added new peer manually: " << peer.toString();
     }
+    joinVia(peer);
 }
 
 
-void Networking::updateRoutingTable(const QString &origin, const QHostAddress &sender, quint16 senderPort, const QVariantMap &message) {
-    if (!routingTable.contains(origin) || vectorClock.getClock()[origin] < message["SeqNo"].toInt()) {
-        routingTable[origin] = {sender, senderPort};
-
-        if (message.contains("LastIP") && message.contains("LastPort")) {
-            QHostAddress publicIP(message["LastIP"].toString());
-            quint16 publicPort = message["LastPort"].toUInt();
-            routingTable[origin] = {publicIP, publicPort};  //storinng public NAT address
+bool Networking::updateRoutingTable(const QString &origin, const QHostAddress &sender, quint16 senderPort, int seqNo,
+                                    const QString &publicIP, quint16 publicPort) {
+    if (!routingTable.contains(origin) || routeSeqNo.value(origin) < seqNo) {
+        routeSeqNo.insert(origin, seqNo);
+        if (!publicIP.isEmpty()) {
+            routingTable[origin] = {QHostAddress(publicIP), publicPort};  //storinng public NAT address
+        } else {
+            routingTable[origin] = {sender, senderPort};
         }
 
-        qDebug() << "updated route for:" << origin
-                 << "local IP:" << sender.toString()
-                 << "public IP:" << routingTable[origin].first.toString()
-                 << "port:" << routingTable[origin].second;
+        NET_TRACE() << "updated route for:" << origin
+                    << "local IP:" << sender.toString()
+                    << "public IP:" << routingTable[origin].first.toString()
+                    << "port:" << routingTable[origin].second;
+        return true;
     }
+    return false;
 }
 
 
+//history survives restarts: the clock and our own sequence numbers continue where they stopped.
+//Further instances on the same host get <directory>-2, <directory>-3, ... of their own
+bool Networking::openHistory(const QString &directory) {
+    QString dir = directory;
+    for (int instance = 2; !history.open(dir); ++instance) {
+        if (!history.inUseElsewhere() || instance > HISTORY_INSTANCES) return false;
+        dir = directory + "-" + QString::number(instance);
+    }
+    if (dir != directory) qDebug() << "history directory in use, this instance keeps its history in" << dir;
+    for (const QString &origin : history.origins()) {
+        int last = history.lastSequence(origin);
+        vectorClock.updateClock(origin, last);
+        if (origin == localNodeId) sequenceNumber = qMax(sequenceNumber, last + 1);
+    }
+    qDebug() << "history:" << history.recordCount() << "messages in" << history.segmentCount() << "segments";
+    return true;
+}
+
+QList<ChatMessage> Networking::recentHistory(int count) const {
+    return history.tail(count);
+}
+
+//pull-based anti-entropy: a random neighbour is sent our clock and replies with what we lack
+void Networking::runAntiEntropy() {
+    QHostAddress peer = membership.randomActive();
+    if (!peer.isNull()) requestCatchUp(peer);
+}
+
+//the clock goes out in slices of at most CATCHUP_ORIGINS_PER_REQUEST origins. Each slice covers a
+//range of origin names rather than a list, so origins we have never heard of are still served
+//(an empty Until means no upper bound)
+void Networking::requestCatchUp(const QHostAddress &peer, const QString &from, const QString &until) {
+    const QMap<QString, int> clock = vectorClock.getClock();
+    auto it = clock.lowerBound(from);
+    const auto end = until.isEmpty() ? clock.constEnd() : clock.lowerBound(until);
+    QString sliceFrom = from;
+    do {
+        QJsonObject have;
+        for (; it != end && have.size() < CATCHUP_ORIGINS_PER_REQUEST; ++it) {
+            have.insert(it.key(), it.value());
+        }
+        const QString sliceUntil = it == end ? until : it.key();
+        QJsonObject msg;
+        msg.insert(QLatin1String("Type"), QLatin1String("CATCHUP_REQUEST"));
+        msg.insert(QLatin1String("Origin"), localNodeId);
+        msg.insert(QLatin1String("Have"), have);
+        if (!sliceFrom.isEmpty()) msg.insert(QLatin1String("From"), sliceFrom);
+        if (!sliceUntil.isEmpty()) msg.insert(QLatin1String("Until"), sliceUntil);
+        queueTo(QJsonDocument(msg).toJson(QJsonDocument::Compact), peer, configuredPort, MessageType::CatchUpRequest);
+        sliceFrom = sliceUntil;
+    } while (it != end);
+}
+
 int Networking::getNextSequenceNumber() {
     return sequenceNumber++;
 }
@@ -229,7 +1027,7 @@ void Networking::sendPrivateMessage(const QString &dest, const QString &message)
 
     QVariantMap msg;
     msg["Type"] = "PRIVATE_MESSAGE";
-    msg["Origin"] = QHostInfo::localHostName();
+    msg["Origin"] = localNodeId;
     msg["Dest"] = dest;
     msg["ChatText"] = message;
     msg["HopLimit"] = 10;
@@ -238,6 +1036,19 @@ void Networking::sendPrivateMessage(const QString &dest, const QString &message)
     quint16 targetPort = routingTable[dest].second;
 
     QByteArray datagram = QJsonDocument(QJsonObject::fromVariantMap(msg)).toJson();
-    udpSocket->writeDatagram(datagram, targetIP, targetPort);
+    writeTo(datagram, targetIP, targetPort, MessageType::PrivateMessage);
+}
+
+void Networking::sendTo(const QPair<QHostAddress, quint16> &target, const QVariantMap &msg) {
+    QByteArray datagram = QJsonDocument(QJsonObject::fromVariantMap(msg)).toJson();
+    writeTo(datagram, target.first, target.second, messageTypeFromString(msg["Type"].toString()));
+}
+
+void Networking::sendToNeighbors(const QVariantMap &msg) {
+    QByteArray datagram = QJsonDocument(QJsonObject::fromVariantMap(msg)).toJson();
+    MessageType type = messageTypeFromString(msg["Type"].toString());
+    for (const QHostAddress &peer : membership.activeView()) {
+        writeTo(datagram, peer, configuredPort, type);
+    }
 }
 
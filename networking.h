@@ -3,51 +3,176 @@
 
 #include <QObject>
 #include <QUdpSocket>
-#include <QTextEdit>
 #include <QSet>
 #include <QHostAddress>
 #include <QTimer>
+#include <QJsonObject>
+#include <QRandomGenerator>
 #include "vectorclock.h"
+#include "metrics.h"
+#include "messages.h"
+#include "messagedispatcher.h"
+#include "outboundbatcher.h"
+#include "membership.h"
+#include "messagelog.h"
 
 class Networking : public QObject {
     Q_OBJECT
 
 public:
     explicit Networking(QObject *parent = nullptr);
-    void sendDatagram(const QByteArray &datagram, int sequenceNumber);
-    void processIncomingDatagrams(QTextEdit *chatLog);
+    void sendDatagram(const QByteArray &datagram, int sequenceNumber, MessageType type = MessageType::Chat);
+    int sendChat(const QString &chatText, int hopLimit = DEFAULT_HOP_LIMIT);  //returns its sequence number
+    void processIncomingDatagrams();
     void broadcastDiscovery();
     void runGossip();
     int getNextSequenceNumber();
     void setNoForwardMode(bool mode);
-    QSet<QHostAddress> getPeers() const;
+    QSet<QHostAddress> getPeers() const;  //active view, the neighbours all traffic goes to
+    QSet<QHostAddress> getPassivePeers() const;
+    void setViewSizes(int activeSize, int passiveSize);
     void runAntiEntropy();
+    bool openHistory(const QString &directory);
+    QList<ChatMessage> recentHistory(int count) const;
     void addPeer(const QHostAddress &peer);
     void forwardMessage(const QByteArray &datagram, const QHostAddress &sender);
     void sendPrivateMessage(const QString &dest, const QString &message);
     void sendRouteRumor();
-    void updateRoutingTable(const QString &origin, const QHostAddress &sender, quint16 senderPort, const QVariantMap &message);
+    bool updateRoutingTable(const QString &origin, const QHostAddress &sender, quint16 senderPort, int seqNo,
+                            const QString &publicIP = QString(), quint16 publicPort = 0);  //true if the route changed
+    void sendTo(const QPair<QHostAddress, quint16> &target, const QVariantMap &msg);
+    void sendToNeighbors(const QVariantMap &msg);
+    bool bind(const QHostAddress &address, quint16 port);
+    bool listen(quint16 port = DEFAULT_PEER_PORT);
+    void setNodeId(const QString &id);
+    QString nodeId() const;
+    QMap<QString, QPair<QHostAddress, quint16>> getRoutingTable() const;
+    void setLinkImpairment(double lossRate, int delayMs, quint32 seed = 1);  //used by the loopback benchmark
+    quint64 getBytesSent() const;
+    quint64 getBytesReceived() const;
+    quint64 getDatagramsSent() const;
+    quint64 getDatagramsReceived() const;
+    void setStatsDump(const QString &path, int intervalMs);  //empty path dumps to the log
+    QJsonObject statsSnapshot();
+    void probePeers();
+    void setBatching(int flushWindowMs, int mtu = DEFAULT_BATCH_MTU);  //0 ms sends every message on its own
+    quint16 peerPort() const;
+    void setMulticastGroup(const QHostAddress &group);  //null address disables multicast, discovery falls back to broadcast
+    void startDiscovery();
+    void startPeerExchange(int intervalMs = PEER_EXCHANGE_INTERVAL_MS);
     constexpr static quint16 DEFAULT_PEER_PORT = 45454;
+    constexpr static const char *DEFAULT_MULTICAST_GROUP = "239.255.45.45";
+    constexpr static int PEER_EXCHANGE_INTERVAL_MS = 15000;
+    constexpr static int PEER_EXCHANGE_SAMPLE = 8;
+    constexpr static int DEFAULT_ACTIVE_VIEW = 5;
+    constexpr static int DEFAULT_PASSIVE_VIEW = 30;
+    constexpr static int DEFAULT_BATCH_WINDOW_MS = 5;
+    constexpr static int DEFAULT_BATCH_MTU = 1400;
+    constexpr static int DEFAULT_HOP_LIMIT = 10;  //relays allowed for a chat
 
 signals:
-    void fileRequestReceived(const QVariantMap &msg);
-    void blockReplyReceived(const QVariantMap &msg);
-    void searchReplyReceived(const QVariantMap &msg);
+    void fileRequestReceived(const FileRequestMessage &msg);
+    void blockReplyReceived(const BlockReplyMessage &msg);
+    void searchReplyReceived(const SearchResponseMessage &msg);
+    void searchRequestReceived(const SearchRequestMessage &msg);
+    void chatMessageReceived(const QString &origin, int seqNum, const QString &chatText);
+    void privateMessageReceived(const QString &origin, const QString &chatText);
 
 
 
 
 private slots:
     void handleIncomingDatagrams();
+    void dumpStats();
+    void exchangeWithRandomPeer();
+    void maintainOverlay();
 
 private:
+    void writeTo(const QByteArray &datagram, const QHostAddress &host, quint16 port, MessageType type);
+    void queueTo(const QByteArray &message, const QHostAddress &host, quint16 port, MessageType type);
+    QByteArray encodeRouteRumor() const;
+    QByteArray piggybackRouteRumor(const QHostAddress &host, int room);
+    void registerHandlers();
+    void forwardObject(QJsonObject message, MessageType type, const QHostAddress &sender);
+    void relayToDestination(QJsonObject message, MessageType type, const QString &dest, const QHostAddress &sender);
+    void handleChat(const ChatMessage &msg, const IncomingMessage &in);
+    void handleDiscovery(const IncomingMessage &in);
+    void handleDiscoveryResponse(const IncomingMessage &in);
+    void handlePrivateMessage(const PrivateChatMessage &msg, const IncomingMessage &in);
+    void handleRouteRumor(const RouteRumorMessage &msg, const IncomingMessage &in);
+    void handlePing(const IncomingMessage &in);
+    void handlePong(const IncomingMessage &in);
+    void handleStatsRequest(const IncomingMessage &in);
+    void handleBatch(const IncomingMessage &in);
+    void handlePeerExchange(const PeerExchangeMessage &msg, const IncomingMessage &in);
+    void handleJoin(const IncomingMessage &in);
+    void handleForwardJoin(const ForwardJoinMessage &msg, const IncomingMessage &in);
+    void handleNeighbor(const NeighborMessage &msg, const IncomingMessage &in);
+    void handleNeighborReply(const NeighborReplyMessage &msg, const IncomingMessage &in);
+    void handleDisconnect(const IncomingMessage &in);
+    void handleSearchRequest(const SearchRequestMessage &msg, const IncomingMessage &in);
+    void forwardSearch(QJsonObject message, int budget, int hopLimit, const QHostAddress &sender);
+    void sendPeerExchange(const QHostAddress &peer, bool reply);
+    void sendOverlayMessage(const QHostAddress &peer, MessageType type, QJsonObject message = QJsonObject());
+    void learnPeer(const QHostAddress &peer);
+    void joinVia(const QHostAddress &contact);
+    void addNeighbor(const QHostAddress &peer);
+    void disconnectFrom(const QHostAddress &peer);
+    void requestNeighbor(const QHostAddress &peer, bool highPriority);
+    void repairActiveView(const QHostAddress &exclude = QHostAddress());
+    void handleCatchUpRequest(const IncomingMessage &in);
+    void handleCatchUpDone(const IncomingMessage &in);
+    void requestCatchUp(const QHostAddress &peer, const QString &from = QString(), const QString &until = QString());
+    bool isLocalAddress(const QHostAddress &address) const;
+    void joinMulticast();
+
     QUdpSocket *udpSocket;
-    QSet<QHostAddress> peers;
+    QString localNodeId;
+    Membership membership{DEFAULT_ACTIVE_VIEW, DEFAULT_PASSIVE_VIEW};
+    QHash<QHostAddress, qint64> pendingNeighbors;  //NEIGHBOR requests awaiting a reply, by uptime ms sent
+    quint16 configuredPort = DEFAULT_PEER_PORT;  //port we listen on and send to
+    QSet<QHostAddress> localAddresses;           //our own addresses, never added as peers
+    QHostAddress multicastGroup{QString::fromLatin1(DEFAULT_MULTICAST_GROUP)};
+    bool multicastJoined = false;
+    QTimer *discoveryTimer = nullptr;
+    QTimer *exchangeTimer = nullptr;
+    QTimer *maintenanceTimer;
     VectorClock vectorClock;
     int sequenceNumber = 1;
-    QMap<int, QByteArray> messageBuffer;
+    QMap<int, QByteArray> messageBuffer;  //latest own messages for gossip resends, older ones are served from history
+    MessageLog history;
+    QTimer *antiEntropyTimer;
     QMap<QString, QPair<QHostAddress, quint16>> routingTable;  //DSDV Routing Table
+    QHash<QString, int> routeSeqNo;  //SeqNo of the rumor behind each route, 0 for routes learned from chat
+    int rumorSeqNo;                  //our own DSDV sequence number
     bool noforwardMode = false;
+    double impairLossRate = 0.0;
+    int impairDelayMs = 0;
+    QRandomGenerator impairRng;  //own generator, so a benchmark seed reproduces the same losses
+    NetworkMetrics metrics;
+    QTimer *statsTimer = nullptr;
+    QString statsPath;
+    MessageDispatcher dispatcher;
+    QByteArray receiveBuffer;  //reused for every datagram, grows to the largest seen
+    OutboundBatcher *batcher;
+    QHash<QHostAddress, qint64> lastRumorAt;  //uptime ms of the last route rumor sent to each peer
+    QHash<QString, qint64> recentSearches;    //origin + '\n' + query: uptime ms first seen
+    constexpr static qint64 ROUTE_RUMOR_PIGGYBACK_MS = 30000;
+    constexpr static int DISCOVERY_RETRY_MS = 10000;
+    constexpr static int DISCOVERY_FULL_REPLY_ODDS = 4;  //a node with a full active view answers one announcement in this many
+    constexpr static int ACTIVE_WALK_LENGTH = 6;   //FORWARD_JOIN hops before the new node must be accepted
+    constexpr static int PASSIVE_WALK_LENGTH = 3;  //hop at which the new node is also kept as a backup
+    constexpr static int MAINTENANCE_INTERVAL_MS = 2000;
+    constexpr static qint64 FAILURE_TIMEOUT_MS = 6000;   //three missed keepalives
+    constexpr static qint64 NEIGHBOR_TIMEOUT_MS = 2000;
+    constexpr static int MESSAGE_BUFFER_LIMIT = 128;
+    constexpr static int ANTI_ENTROPY_INTERVAL_MS = 10000;
+    constexpr static int ROUTED_HOP_LIMIT = 16;  //for messages relayed by Dest that carry no HopLimit
+    constexpr static int CATCHUP_MAX_MESSAGES = 256;  //per CATCHUP_REQUEST, the requester asks again for more
+    constexpr static qint64 CATCHUP_MAX_BYTES = 64 * 1024;
+    constexpr static int CATCHUP_ORIGINS_PER_REQUEST = 24;  //keeps a request's clock slice within one datagram
+    constexpr static int HISTORY_INSTANCES = 16;  //numbered history directories tried when the given one is in use
+    constexpr static qint64 SEARCH_DUPLICATE_MS = 1000;  //a search seen again within this window came by another path
 };
 
 #endif
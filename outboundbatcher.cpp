@@ -0,0 +1,100 @@
+#include "outboundbatcher.h"
+
+namespace {
+const QByteArray batchHeader = QByteArrayLiteral("{\"Type\":\"BATCH\",\"Messages\":[");
+const QByteArray batchTrailer = QByteArrayLiteral("]}");
+const int batchOverhead = batchHeader.size() + batchTrailer.size();
+}
+
+OutboundBatcher::OutboundBatcher(SendFn send, QObject *parent)
+    : QObject(parent), send(std::move(send)) {
+    flushTimer.setSingleShot(true);
+    connect(&flushTimer, &QTimer::timeout, this, &OutboundBatcher::flush);
+}
+
+void OutboundBatcher::setFlushWindow(int ms) {
+    windowMs = qMax(0, ms);
+    if (windowMs == 0) flush();
+}
+
+int OutboundBatcher::flushWindow() const {
+    return windowMs;
+}
+
+void OutboundBatcher::setMtu(int bytes) {
+    mtuBytes = qMax(batchOverhead + 1, bytes);
+}
+
+int OutboundBatcher::mtu() const {
+    return mtuBytes;
+}
+
+void OutboundBatcher::setPiggyback(PiggybackFn fn) {
+    piggyback = std::move(fn);
+}
+
+void OutboundBatcher::enqueue(const QByteArray &message, const QHostAddress &host, quint16 port, MessageType type) {
+    const PeerKey key{host, port};
+
+    if (windowMs == 0 || batchOverhead + message.size() > mtuBytes) {
+        //too big to share a datagram: flush what is queued first so the peer sees messages in order
+        auto it = pending.find(key);
+        if (it != pending.end()) flushPeer(key, it.value());
+        send(message, host, port, type);
+        return;
+    }
+
+    Pending &p = pending[key];
+    if (!p.messages.isEmpty() && batchOverhead + p.bytes + 1 + message.size() > mtuBytes) {
+        flushPeer(key, p);
+    }
+    if (p.messages.isEmpty()) p.firstType = type;
+    p.bytes += (p.messages.isEmpty() ? 0 : 1) + message.size();
+    p.messages.append(message);
+
+    if (!flushTimer.isActive()) flushTimer.start(windowMs);
+}
+
+void OutboundBatcher::flush() {
+    flushTimer.stop();
+    for (auto it = pending.begin(); it != pending.end(); ++it) {
+        if (!it.value().messages.isEmpty()) flushPeer(it.key(), it.value());
+    }
+    pending.clear();
+}
+
+int OutboundBatcher::pendingMessages() const {
+    int count = 0;
+    for (const Pending &p : pending) count += p.messages.size();
+    return count;
+}
+
+void OutboundBatcher::flushPeer(const PeerKey &peer, Pending &p) {
+    if (piggyback) {
+        int room = mtuBytes - batchOverhead - p.bytes - 1;
+        QByteArray extra = room > 0 ? piggyback(peer.first, room) : QByteArray();
+        if (!extra.isEmpty() && extra.size() <= room) {
+            p.bytes += 1 + extra.size();
+            p.messages.append(extra);
+        }
+    }
+
+    if (p.messages.size() == 1) {
+        send(p.messages.first(), peer.first, peer.second, p.firstType);
+    } else {
+        QByteArray datagram;
+        datagram.reserve(batchOverhead + p.bytes);
+        datagram += batchHeader;
+        for (int i = 0; i < p.messages.size(); ++i) {
+            if (i > 0) datagram += ',';
+            datagram += p.messages[i];
+        }
+        datagram += batchTrailer;
+        send(datagram, peer.first, peer.second, MessageType::Batch);
+        batches++;
+        batchedMessages += p.messages.size();
+    }
+
+    p.messages.clear();
+    p.bytes = 0;
+}
@@ -0,0 +1,60 @@
+#ifndef OUTBOUNDBATCHER_H
+#define OUTBOUNDBATCHER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QTimer>
+#include <functional>
+#include "messagetypes.h"
+
+//collects small outgoing messages per peer and sends them as one BATCH datagram
+//({"Type":"BATCH","Messages":[...]}) once the flush window expires or the MTU is reached
+class OutboundBatcher : public QObject {
+    Q_OBJECT
+
+public:
+    using SendFn = std::function<void(const QByteArray &datagram, const QHostAddress &host, quint16 port, MessageType type)>;
+    //called when a batch for host is flushed; may return an extra encoded message of at most room bytes
+    using PiggybackFn = std::function<QByteArray(const QHostAddress &host, int room)>;
+
+    explicit OutboundBatcher(SendFn send, QObject *parent = nullptr);
+
+    void setFlushWindow(int ms);  //0 disables batching, every message is sent immediately
+    int flushWindow() const;
+    void setMtu(int bytes);
+    int mtu() const;
+    void setPiggyback(PiggybackFn fn);
+
+    //message must be one encoded JSON object
+    void enqueue(const QByteArray &message, const QHostAddress &host, quint16 port, MessageType type);
+    void flush();
+
+    int pendingMessages() const;
+    quint64 batchesSent() const { return batches; }
+    quint64 messagesBatched() const { return batchedMessages; }
+
+private:
+    using PeerKey = QPair<QHostAddress, quint16>;
+    struct Pending {
+        QList<QByteArray> messages;
+        MessageType firstType = MessageType::Unknown;
+        int bytes = 0;  //encoded size of the messages plus separating commas
+    };
+
+    void flushPeer(const PeerKey &peer, Pending &pending);
+
+    SendFn send;
+    PiggybackFn piggyback;
+    QHash<PeerKey, Pending> pending;
+    QTimer flushTimer;
+    int windowMs = 0;
+    int mtuBytes = 1400;
+    quint64 batches = 0;
+    quint64 batchedMessages = 0;
+};
+
+#endif
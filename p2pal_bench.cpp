@@ -0,0 +1,645 @@
+//Loopback benchmark for the networking layer.
+//Runs N Networking nodes in one process, each bound to its own 127.0.0.x address,
+//wires them into a topology and prints a JSON report that can be diffed between builds.
+//Search and file transfer replies are produced by a small in-harness responder that speaks
+//the same SEARCH_*/FILE_REQUEST/BLOCK_REPLY messages as MainWindow, so only the networking
+//path is measured.
+
+#include "networking.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+namespace {
+
+struct BenchConfig {
+    int nodes = 8;
+    QString topology = "full";
+    int degree = 3;
+    double loss = 0.0;
+    int delayMs = 0;
+    int messages = 200;
+    int messageIntervalMs = 5;
+    int hopLimit = Networking::DEFAULT_HOP_LIMIT;
+    int gossipIntervalMs = 1000;
+    int batchWindowMs = Networking::DEFAULT_BATCH_WINDOW_MS;
+    int exchangeIntervalMs = 0;
+    int activeView = Networking::DEFAULT_ACTIVE_VIEW;
+    int passiveView = Networking::DEFAULT_PASSIVE_VIEW;
+    bool history = false;
+    int queries = 50;
+    int filesPerNode = 200;
+    int transfers = 3;
+    int transferBlocks = 256;
+    int blockSize = 32 * 1024;
+    int transferBurst = 4;
+    int timeoutMs = 10000;
+    quint32 seed = 1;
+    QString output;
+};
+
+bool benchVerbose = false;
+
+void benchMessageHandler(QtMsgType type, const QMessageLogContext &, const QString &msg) {
+    if (type == QtDebugMsg && !benchVerbose) return;
+    fprintf(stderr, "%s\n", qPrintable(msg));
+}
+
+QHostAddress nodeAddress(int index) {
+    return QHostAddress(quint32(0x7F000001u + quint32(index)));  //127.0.0.1, 127.0.0.2, ...
+}
+
+QString nodeName(int index) {
+    return QString("node-%1").arg(index);
+}
+
+double elapsedMs(const QElapsedTimer &clock) {
+    return clock.nsecsElapsed() / 1e6;
+}
+
+//pumps the event loop until done() holds or the timeout expires
+bool waitUntil(const std::function<bool()> &done, int timeoutMs) {
+    QElapsedTimer clock;
+    clock.start();
+    QTimer tick;
+    tick.start(1);
+    while (!done()) {
+        if (clock.elapsed() >= timeoutMs) return false;
+        QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+    }
+    return true;
+}
+
+void pump(int ms) {
+    waitUntil([]() { return false; }, ms);
+}
+
+QJsonObject summarize(std::vector<double> values) {
+    QJsonObject stats;
+    stats["count"] = int(values.size());
+    if (values.empty()) return stats;
+
+    std::sort(values.begin(), values.end());
+    auto percentile = [&](double p) {
+        size_t rank = size_t(p * (values.size() - 1) + 0.5);
+        return values[std::min(rank, values.size() - 1)];
+    };
+    double sum = 0;
+    for (double v : values) sum += v;
+
+    stats["min"] = values.front();
+    stats["p50"] = percentile(0.50);
+    stats["p90"] = percentile(0.90);
+    stats["p99"] = percentile(0.99);
+    stats["max"] = values.back();
+    stats["mean"] = sum / values.size();
+    return stats;
+}
+
+std::vector<QSet<int>> buildTopology(const BenchConfig &cfg, QRandomGenerator &rng) {
+    std::vector<QSet<int>> adj(cfg.nodes);
+    auto link = [&](int a, int b) {
+        if (a == b) return;
+        adj[a].insert(b);
+        adj[b].insert(a);
+    };
+
+    if (cfg.topology == "full") {
+        for (int i = 0; i < cfg.nodes; ++i)
+            for (int j = i + 1; j < cfg.nodes; ++j) link(i, j);
+    } else if (cfg.topology == "ring") {
+        for (int i = 0; i < cfg.nodes; ++i) link(i, (i + 1) % cfg.nodes);
+    } else if (cfg.topology == "line") {
+        for (int i = 0; i + 1 < cfg.nodes; ++i) link(i, i + 1);
+    } else if (cfg.topology == "star") {
+        for (int i = 1; i < cfg.nodes; ++i) link(0, i);
+    } else if (cfg.topology == "bootstrap") {
+        //only node 0 is known up front, joins and peer exchange have to build the rest
+        for (int i = 1; i < cfg.nodes; ++i) adj[i].insert(0);
+    } else {
+        //random: a ring keeps the graph connected, then random chords up to the target degree
+        for (int i = 0; i < cfg.nodes; ++i) link(i, (i + 1) % cfg.nodes);
+        int wanted = std::min(cfg.degree, cfg.nodes - 1);
+        for (int i = 0; i < cfg.nodes; ++i) {
+            int attempts = 0;
+            while (adj[i].size() < wanted && attempts++ < cfg.nodes * 4) {
+                link(i, int(rng.bounded(quint32(cfg.nodes))));
+            }
+        }
+    }
+    return adj;
+}
+
+struct SyntheticFile {
+    QString name;
+    qint64 size;
+    QString hash;
+};
+
+} //namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("p2pal_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Loopback multi-node benchmark for the P2Pal networking layer");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"nodes", "Number of nodes (bound to 127.0.0.1..N).", "n", "8"},
+        {"topology", "full, ring, line, star, random or bootstrap.", "name", "full"},
+        {"degree", "Target degree for the random topology and the membership phase.", "k", "3"},
+        {"loss", "Outgoing datagram loss rate, 0..1.", "rate", "0"},
+        {"delay", "Added one-way delay per datagram in ms.", "ms", "0"},
+        {"messages", "Chat messages to disseminate.", "n", "200"},
+        {"interval", "Gap between chat messages in ms.", "ms", "5"},
+        {"hop-limit", "HopLimit set on chat messages (0 = omit, only direct neighbours get them).", "n",
+         QString::number(Networking::DEFAULT_HOP_LIMIT)},
+        {"gossip-interval", "runGossip period in ms during the chat phase (0 = off).", "ms", "1000"},
+        {"batch-window", "Outbound batching flush window in ms (0 = off).", "ms",
+         QString::number(Networking::DEFAULT_BATCH_WINDOW_MS)},
+        {"exchange-interval", "Peer exchange period in ms (0 = off, bootstrap defaults to 200).", "ms", "0"},
+        {"active-view", "Active view size, the neighbours each node sends to.", "n",
+         QString::number(Networking::DEFAULT_ACTIVE_VIEW)},
+        {"passive-view", "Passive view size, the backups used for repairs.", "n",
+         QString::number(Networking::DEFAULT_PASSIVE_VIEW)},
+        {"queries", "Search queries to issue.", "n", "50"},
+        {"files", "Synthetic files indexed per node.", "n", "200"},
+        {"transfers", "File transfers to run.", "n", "3"},
+        {"blocks", "Blocks per file transfer.", "n", "256"},
+        {"block-size", "Bytes per BLOCK_REPLY payload.", "bytes", "32768"},
+        {"burst", "Blocks sent per event loop turn by the file owner.", "n", "4"},
+        {"history", "Keep chat history on disk and time how fast a late node catches up."},
+        {"timeout", "Per-phase timeout in ms.", "ms", "10000"},
+        {"seed", "Random seed for topology, workload and link loss.", "n", "1"},
+        {"output", "Write the JSON report to this file instead of stdout.", "path"},
+        {"verbose", "Keep the networking layer's qDebug output."},
+    });
+    parser.process(app);
+
+    BenchConfig cfg;
+    cfg.nodes = std::clamp(parser.value("nodes").toInt(), 2, 4096);
+    cfg.topology = parser.value("topology");
+    cfg.degree = parser.value("degree").toInt();
+    cfg.loss = parser.value("loss").toDouble();
+    cfg.delayMs = parser.value("delay").toInt();
+    cfg.messages = parser.value("messages").toInt();
+    cfg.messageIntervalMs = parser.value("interval").toInt();
+    cfg.hopLimit = parser.value("hop-limit").toInt();
+    cfg.gossipIntervalMs = parser.value("gossip-interval").toInt();
+    cfg.batchWindowMs = parser.value("batch-window").toInt();
+    cfg.exchangeIntervalMs = parser.value("exchange-interval").toInt();
+    if (cfg.topology == "bootstrap" && cfg.exchangeIntervalMs <= 0) cfg.exchangeIntervalMs = 200;
+    cfg.activeView = std::max(1, parser.value("active-view").toInt());
+    cfg.passiveView = std::max(0, parser.value("passive-view").toInt());
+    cfg.history = parser.isSet("history");
+    cfg.queries = parser.value("queries").toInt();
+    cfg.filesPerNode = parser.value("files").toInt();
+    cfg.transfers = parser.value("transfers").toInt();
+    cfg.transferBlocks = std::max(1, parser.value("blocks").toInt());
+    cfg.blockSize = std::max(1, parser.value("block-size").toInt());
+    cfg.transferBurst = std::max(1, parser.value("burst").toInt());
+    cfg.timeoutMs = parser.value("timeout").toInt();
+    cfg.seed = parser.value("seed").toUInt();
+    cfg.output = parser.value("output");
+    benchVerbose = parser.isSet("verbose");
+    qInstallMessageHandler(benchMessageHandler);
+
+    QRandomGenerator rng(cfg.seed);
+
+    //--- nodes and topology ---
+    QTemporaryDir historyRoot;
+    std::vector<Networking *> nodes;
+    for (int i = 0; i < cfg.nodes; ++i) {
+        Networking *node = new Networking(&app);
+        node->setNodeId(nodeName(i));
+        if (!node->bind(nodeAddress(i), Networking::DEFAULT_PEER_PORT)) {
+            qWarning() << "could not bind" << nodeAddress(i).toString() << "- is the port in use?";
+            return 1;
+        }
+        if (cfg.history && !node->openHistory(historyRoot.filePath(nodeName(i)))) {
+            qWarning() << "could not open history in" << historyRoot.path();
+            return 1;
+        }
+        node->setLinkImpairment(cfg.loss, cfg.delayMs, cfg.seed + quint32(i));
+        node->setBatching(cfg.batchWindowMs);
+        node->setViewSizes(cfg.activeView, cfg.passiveView);
+        nodes.push_back(node);
+    }
+
+    //the topology only picks each node's contacts, the overlay decides the actual neighbours
+    std::vector<QSet<int>> adjacency = buildTopology(cfg, rng);
+    for (int i = 0; i < cfg.nodes; ++i) {
+        for (int j : adjacency[i]) nodes[i]->addPeer(nodeAddress(j));
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+
+    //--- membership: joins from the initial contacts, plus peer exchange if enabled ---
+    const int targetPeers = std::min({cfg.degree, cfg.activeView, cfg.nodes - 1});
+    auto fewestPeers = [&]() {
+        int fewest = cfg.nodes;
+        for (Networking *node : nodes) fewest = std::min(fewest, int(node->getPeers().size()));
+        return fewest;
+    };
+
+    double membershipStart = elapsedMs(clock);
+    if (cfg.exchangeIntervalMs > 0) {
+        for (Networking *node : nodes) node->startPeerExchange(cfg.exchangeIntervalMs);
+    }
+    bool membershipConverged = waitUntil([&]() { return fewestPeers() >= targetPeers; }, cfg.timeoutMs);
+    double membershipTime = elapsedMs(clock) - membershipStart;
+
+    //transfers pick neighbours from the active views the overlay settled on
+    std::vector<double> activeCounts, passiveCounts;
+    for (int i = 0; i < cfg.nodes; ++i) {
+        const QSet<QHostAddress> neighbours = nodes[i]->getPeers();
+        activeCounts.push_back(neighbours.size());
+        passiveCounts.push_back(nodes[i]->getPassivePeers().size());
+        adjacency[i].clear();
+        for (const QHostAddress &peer : neighbours) {
+            adjacency[i].insert(int(peer.toIPv4Address() - nodeAddress(0).toIPv4Address()));
+        }
+    }
+
+    QJsonObject membershipReport;
+    membershipReport["converged"] = membershipConverged;
+    membershipReport["time_ms"] = membershipConverged ? membershipTime : -1.0;
+    membershipReport["target_peers"] = targetPeers;
+    membershipReport["active_peers"] = summarize(activeCounts);
+    membershipReport["passive_peers"] = summarize(passiveCounts);
+
+    int edges = 0;
+    for (const QSet<int> &neighbours : adjacency) edges += neighbours.size();
+    edges /= 2;
+
+    //--- route convergence ---
+    auto routedPairs = [&]() {
+        int routed = 0;
+        for (int i = 0; i < cfg.nodes; ++i) {
+            const auto table = nodes[i]->getRoutingTable();
+            for (int j = 0; j < cfg.nodes; ++j) {
+                if (i != j && table.contains(nodeName(j))) routed++;
+            }
+        }
+        return routed;
+    };
+    const int allPairs = cfg.nodes * (cfg.nodes - 1);
+
+    double routeStart = elapsedMs(clock);
+    for (Networking *node : nodes) node->sendRouteRumor();
+    bool routesConverged = waitUntil([&]() { return routedPairs() == allPairs; }, cfg.timeoutMs);
+    double routeTime = elapsedMs(clock) - routeStart;
+
+    QJsonObject routeReport;
+    routeReport["converged"] = routesConverged;
+    routeReport["time_ms"] = routesConverged ? routeTime : -1.0;
+    routeReport["routed_fraction"] = double(routedPairs()) / allPairs;
+
+    //--- chat dissemination and gossip bandwidth ---
+    QHash<QString, double> sendTimes;
+    std::vector<double> chatLatencies;
+    int deliveries = 0;
+    for (int i = 0; i < cfg.nodes; ++i) {
+        QObject::connect(nodes[i], &Networking::chatMessageReceived, &app,
+                         [&, i](const QString &origin, int seqNum, const QString &) {
+            if (origin == nodeName(i)) return;
+            auto it = sendTimes.constFind(origin + "#" + QString::number(seqNum));
+            if (it == sendTimes.constEnd()) return;
+            chatLatencies.push_back(elapsedMs(clock) - it.value());
+            deliveries++;
+        });
+    }
+
+    std::vector<quint64> sentBefore, receivedBefore;
+    quint64 datagramsBefore = 0;
+    for (Networking *node : nodes) {
+        sentBefore.push_back(node->getBytesSent());
+        receivedBefore.push_back(node->getBytesReceived());
+        datagramsBefore += node->getDatagramsSent();
+    }
+
+    QTimer gossipTimer;
+    QObject::connect(&gossipTimer, &QTimer::timeout, &app, [&]() {
+        for (Networking *node : nodes) node->runGossip();
+    });
+    if (cfg.gossipIntervalMs > 0) gossipTimer.start(cfg.gossipIntervalMs);
+
+    double chatStart = elapsedMs(clock);
+    for (int m = 0; m < cfg.messages; ++m) {
+        Networking *origin = nodes[m % cfg.nodes];
+        double sentAt = elapsedMs(clock);
+        int seq = origin->sendChat(QString("bench message %1").arg(m), cfg.hopLimit);
+        sendTimes.insert(origin->nodeId() + "#" + QString::number(seq), sentAt);  //delivery needs the event loop
+
+        if (cfg.messageIntervalMs > 0) pump(cfg.messageIntervalMs);
+        else QCoreApplication::processEvents();
+    }
+    const int expectedDeliveries = cfg.messages * (cfg.nodes - 1);
+    waitUntil([&]() { return deliveries >= expectedDeliveries; }, cfg.timeoutMs);
+    double chatDuration = elapsedMs(clock) - chatStart;
+    gossipTimer.stop();
+
+    std::vector<double> sentRate, receivedRate;
+    quint64 bytesSentTotal = 0, datagramsSentTotal = 0;
+    for (int i = 0; i < cfg.nodes; ++i) {
+        quint64 sent = nodes[i]->getBytesSent() - sentBefore[i];
+        quint64 received = nodes[i]->getBytesReceived() - receivedBefore[i];
+        sentRate.push_back(sent * 1000.0 / chatDuration);
+        receivedRate.push_back(received * 1000.0 / chatDuration);
+        bytesSentTotal += sent;
+        datagramsSentTotal += nodes[i]->getDatagramsSent();
+    }
+    datagramsSentTotal -= datagramsBefore;
+
+    QJsonObject chatReport;
+    chatReport["messages"] = cfg.messages;
+    chatReport["expected_deliveries"] = expectedDeliveries;
+    chatReport["deliveries"] = deliveries;
+    chatReport["delivery_ratio"] = expectedDeliveries ? double(deliveries) / expectedDeliveries : 0.0;
+    chatReport["latency_ms"] = summarize(chatLatencies);
+
+    QJsonObject bandwidthReport;
+    bandwidthReport["duration_ms"] = chatDuration;
+    bandwidthReport["bytes_sent_total"] = double(bytesSentTotal);
+    bandwidthReport["datagrams_sent_total"] = double(datagramsSentTotal);
+    bandwidthReport["bytes_sent_per_node_per_sec"] = summarize(sentRate);
+    bandwidthReport["bytes_received_per_node_per_sec"] = summarize(receivedRate);
+
+    //--- search ---
+    std::vector<std::vector<SyntheticFile>> indexes(cfg.nodes);
+    for (int i = 0; i < cfg.nodes; ++i) {
+        for (int k = 0; k < cfg.filesPerNode; ++k) {
+            QString name = QString("%1 file %2.bin").arg(nodeName(i)).arg(k);
+            QString hash = QString::number(qHash(name), 16);
+            indexes[i].push_back({name, qint64(k + 1) * 1024, hash});
+        }
+    }
+
+    struct PendingQuery {
+        int requester = -1;
+        QString target;
+        double start = 0;
+        double latency = 0;
+        bool hit = false;
+    } query;
+
+    for (int i = 0; i < cfg.nodes; ++i) {
+        //responder: same matching rule as MainWindow::handleSearchRequest
+        QObject::connect(nodes[i], &Networking::searchRequestReceived, &app, [&, i](const SearchRequestMessage &msg) {
+            QStringList keywords = msg.search.split(" ");
+            QStringList matchNames, matchIDs;
+            QVariantList matchSizes;
+            for (const SyntheticFile &f : indexes[i]) {
+                bool match = std::all_of(keywords.begin(), keywords.end(), [&](const QString &kw) {
+                    return f.name.contains(kw, Qt::CaseInsensitive);
+                });
+                if (match) {
+                    matchNames << f.name;
+                    matchSizes << f.size;
+                    matchIDs << f.hash;
+                }
+            }
+            const QString &requester = msg.origin;
+            const auto table = nodes[i]->getRoutingTable();
+            if (matchNames.isEmpty() || !table.contains(requester)) return;
+
+            QVariantMap reply;
+            reply["Type"] = "SEARCH_RESPONSE";
+            reply["Origin"] = nodes[i]->nodeId();
+            reply["Dest"] = requester;
+            reply["MatchNames"] = matchNames;
+            reply["MatchSizes"] = matchSizes;
+            reply["MatchIDs"] = matchIDs;
+            nodes[i]->sendTo(table.value(requester), reply);
+        });
+
+        QObject::connect(nodes[i], &Networking::searchReplyReceived, &app, [&, i](const SearchResponseMessage &msg) {
+            if (i != query.requester || query.hit) return;
+            if (msg.matchNames.contains(query.target)) {
+                query.hit = true;
+                query.latency = elapsedMs(clock) - query.start;
+            }
+        });
+    }
+
+    std::vector<double> searchLatencies;
+    int hits = 0;
+    for (int q = 0; q < cfg.queries && cfg.filesPerNode > 0; ++q) {
+        int requester = int(rng.bounded(quint32(cfg.nodes)));
+        if (adjacency[requester].isEmpty()) continue;
+        //searches are forwarded along the overlay, so any other node can own the file
+        int owner = (requester + 1 + int(rng.bounded(quint32(cfg.nodes - 1)))) % cfg.nodes;
+        const SyntheticFile &file = indexes[owner][int(rng.bounded(quint32(cfg.filesPerNode)))];
+
+        query.requester = requester;
+        query.target = file.name;
+        query.hit = false;
+        query.start = elapsedMs(clock);
+
+        QVariantMap msg;
+        msg["Type"] = "SEARCH_REQUEST";
+        msg["Origin"] = nodes[requester]->nodeId();
+        msg["Search"] = file.name;
+        msg["Budget"] = 20;
+        msg["HopLimit"] = 10;
+        nodes[requester]->sendToNeighbors(msg);
+
+        if (waitUntil([&]() { return query.hit; }, std::min(cfg.timeoutMs, 2000))) {
+            searchLatencies.push_back(query.latency);
+            hits++;
+        }
+    }
+    query.requester = -1;
+
+    QJsonObject searchReport;
+    searchReport["queries"] = cfg.queries;
+    searchReport["hits"] = hits;
+    searchReport["hit_ratio"] = cfg.queries ? double(hits) / cfg.queries : 0.0;
+    searchReport["latency_ms"] = summarize(searchLatencies);
+
+    //--- file transfer ---
+    struct Transfer {
+        int requester = -1;
+        int owner = -1;
+        QString hash;
+        QSet<int> received;
+        int nextBlock = 0;
+        QPair<QHostAddress, quint16> target;
+    } transfer;
+
+    const QByteArray blockPayload(cfg.blockSize, 'x');
+    QTimer pacer;
+    pacer.setInterval(0);
+    QObject::connect(&pacer, &QTimer::timeout, &app, [&]() {
+        for (int b = 0; b < cfg.transferBurst && transfer.nextBlock < cfg.transferBlocks; ++b) {
+            QVariantMap block;
+            block["Type"] = "BLOCK_REPLY";
+            block["Origin"] = nodes[transfer.owner]->nodeId();
+            block["Dest"] = nodes[transfer.requester]->nodeId();
+            block["BlockReply"] = transfer.hash;
+            block["BlockID"] = transfer.nextBlock++;
+            block["TotalBlocks"] = cfg.transferBlocks;
+            block["BlockData"] = blockPayload;
+            nodes[transfer.owner]->sendTo(transfer.target, block);
+        }
+        if (transfer.nextBlock >= cfg.transferBlocks) pacer.stop();
+    });
+
+    for (int i = 0; i < cfg.nodes; ++i) {
+        QObject::connect(nodes[i], &Networking::fileRequestReceived, &app, [&, i](const FileRequestMessage &msg) {
+            if (i != transfer.owner || msg.request != transfer.hash) return;
+            const QString &requestor = msg.origin;
+            const auto table = nodes[i]->getRoutingTable();
+            if (!table.contains(requestor)) return;
+            transfer.target = table.value(requestor);
+            transfer.nextBlock = 0;
+            pacer.start();
+        });
+        QObject::connect(nodes[i], &Networking::blockReplyReceived, &app, [&, i](const BlockReplyMessage &msg) {
+            if (i != transfer.requester || msg.blockReply != transfer.hash) return;
+            transfer.received.insert(msg.blockID);
+        });
+    }
+
+    std::vector<double> throughputs;
+    int completed = 0;
+    qint64 blocksReceived = 0;
+    for (int t = 0; t < cfg.transfers; ++t) {
+        int requester = int(rng.bounded(quint32(cfg.nodes)));
+        if (adjacency[requester].isEmpty()) continue;
+        QList<int> neighbours = adjacency[requester].values();
+
+        transfer.requester = requester;
+        transfer.owner = neighbours[int(rng.bounded(quint32(neighbours.size())))];
+        transfer.hash = QString("bench-transfer-%1").arg(t);
+        transfer.received.clear();
+
+        QVariantMap req;
+        req["Type"] = "FILE_REQUEST";
+        req["Origin"] = nodes[requester]->nodeId();
+        req["Dest"] = nodes[transfer.owner]->nodeId();
+        req["Request"] = transfer.hash;
+
+        double start = elapsedMs(clock);
+        nodes[requester]->sendTo({nodeAddress(transfer.owner), Networking::DEFAULT_PEER_PORT}, req);
+        bool done = waitUntil([&]() { return transfer.received.size() == cfg.transferBlocks; }, cfg.timeoutMs);
+        double seconds = (elapsedMs(clock) - start) / 1000.0;
+        pacer.stop();
+
+        if (done) completed++;
+        blocksReceived += transfer.received.size();
+        if (seconds > 0) {
+            throughputs.push_back(transfer.received.size() * double(cfg.blockSize) / seconds / (1024.0 * 1024.0));
+        }
+    }
+    transfer.requester = -1;
+    transfer.owner = -1;
+
+    QJsonObject transferReport;
+    transferReport["transfers"] = cfg.transfers;
+    transferReport["completed"] = completed;
+    transferReport["block_size"] = cfg.blockSize;
+    transferReport["blocks_per_transfer"] = cfg.transferBlocks;
+    transferReport["block_delivery_ratio"] = cfg.transfers
+        ? double(blocksReceived) / (double(cfg.transfers) * cfg.transferBlocks) : 0.0;
+    transferReport["throughput_mib_per_sec"] = summarize(throughputs);
+
+    //--- catch-up: a node that missed the chat joins through node 0 and pulls history from disk ---
+    QJsonObject catchupReport;
+    if (cfg.history) {
+        std::vector<double> historyBytes;
+        for (Networking *node : nodes) {
+            historyBytes.push_back(node->statsSnapshot().value("history").toObject().value("bytes").toDouble());
+        }
+        const int available = nodes[0]->statsSnapshot().value("history").toObject().value("records").toInt();
+
+        Networking *late = new Networking(&app);
+        late->setNodeId(nodeName(cfg.nodes));
+        late->setLinkImpairment(cfg.loss, cfg.delayMs, cfg.seed + quint32(cfg.nodes));
+        late->setBatching(cfg.batchWindowMs);
+        late->setViewSizes(cfg.activeView, cfg.passiveView);
+        int caughtUp = 0;
+        QObject::connect(late, &Networking::chatMessageReceived, &app, [&](const QString &, int, const QString &) {
+            caughtUp++;
+        });
+
+        bool ready = late->bind(nodeAddress(cfg.nodes), Networking::DEFAULT_PEER_PORT)
+                     && late->openHistory(historyRoot.filePath(nodeName(cfg.nodes)));
+        double catchupStart = elapsedMs(clock);
+        bool caughtUpAll = false;
+        if (ready) {
+            late->addPeer(nodeAddress(0));
+            caughtUpAll = waitUntil([&]() { return caughtUp >= available; }, cfg.timeoutMs);
+        }
+        double catchupTime = elapsedMs(clock) - catchupStart;
+
+        catchupReport["converged"] = caughtUpAll;
+        catchupReport["time_ms"] = caughtUpAll ? catchupTime : -1.0;
+        catchupReport["available"] = available;
+        catchupReport["received"] = caughtUp;
+        catchupReport["history_bytes_per_node"] = summarize(historyBytes);
+    }
+
+    //--- report ---
+    QJsonObject config;
+    config["nodes"] = cfg.nodes;
+    config["topology"] = cfg.topology;
+    config["edges"] = edges;
+    config["degree"] = cfg.degree;
+    config["loss"] = cfg.loss;
+    config["delay_ms"] = cfg.delayMs;
+    config["messages"] = cfg.messages;
+    config["interval_ms"] = cfg.messageIntervalMs;
+    config["hop_limit"] = cfg.hopLimit;
+    config["gossip_interval_ms"] = cfg.gossipIntervalMs;
+    config["batch_window_ms"] = cfg.batchWindowMs;
+    config["exchange_interval_ms"] = cfg.exchangeIntervalMs;
+    config["active_view"] = cfg.activeView;
+    config["passive_view"] = cfg.passiveView;
+    config["history"] = cfg.history;
+    config["queries"] = cfg.queries;
+    config["files_per_node"] = cfg.filesPerNode;
+    config["seed"] = double(cfg.seed);
+
+    QJsonObject report;
+    report["benchmark"] = "p2pal_bench";
+    report["qt_version"] = qVersion();
+    report["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["config"] = config;
+    report["membership"] = membershipReport;
+    report["route_convergence"] = routeReport;
+    report["chat"] = chatReport;
+    report["bandwidth"] = bandwidthReport;
+    report["search"] = searchReport;
+    report["transfer"] = transferReport;
+    if (cfg.history) report["catchup"] = catchupReport;
+
+    QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (cfg.output.isEmpty()) {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    } else {
+        QFile out(cfg.output);
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qWarning() << "cannot write" << cfg.output;
+            return 1;
+        }
+        out.write(json);
+    }
+    return 0;
+}
@@ -0,0 +1,424 @@
+//Micro-benchmarks for the code that runs on every datagram.
+//Each case is driven with synthetic traffic (many origins, mixed message types, large file
+//indexes) and reports ns/op and heap allocations/op. On glibc every malloc/calloc/realloc is
+//counted, which includes Qt's container storage; elsewhere only operator new is counted.
+
+#include <cstdlib>
+#include "fileindex.h"
+#include "networking.h"
+#include "outboundbatcher.h"
+#include "vectorclock.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QUdpSocket>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <new>
+#include <vector>
+
+namespace {
+std::atomic<quint64> allocationCount{0};
+volatile qint64 benchSink = 0;  //keeps results observable so work is not optimised away
+}
+
+#if defined(__GLIBC__)
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+extern "C" void *malloc(size_t size) noexcept {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) noexcept {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) noexcept {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+#else
+void *operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+#endif
+
+namespace {
+
+struct BenchResult {
+    QString name;
+    qint64 iterations = 0;
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+};
+
+struct BenchOptions {
+    int minTimeMs = 300;
+    QString filter;
+};
+
+void silentMessageHandler(QtMsgType type, const QMessageLogContext &, const QString &msg) {
+    if (type == QtDebugMsg) return;
+    fprintf(stderr, "%s\n", qPrintable(msg));
+}
+
+//runs batch() until minTimeMs has been spent inside it; batch returns the ops it performed.
+//setup() runs outside the timed and counted region before every batch.
+BenchResult runBench(const QString &name, const BenchOptions &opts,
+                     const std::function<qint64()> &batch,
+                     const std::function<void()> &setup = {}) {
+    BenchResult result;
+    result.name = name;
+
+    if (setup) setup();
+    batch();  //warm-up
+
+    qint64 ops = 0, nanos = 0;
+    quint64 allocs = 0;
+    while (nanos < qint64(opts.minTimeMs) * 1000000) {
+        if (setup) setup();
+        quint64 allocsBefore = allocationCount.load(std::memory_order_relaxed);
+        QElapsedTimer timer;
+        timer.start();
+        qint64 done = batch();
+        nanos += timer.nsecsElapsed();
+        allocs += allocationCount.load(std::memory_order_relaxed) - allocsBefore;
+        ops += done;
+        if (done == 0) break;
+    }
+
+    result.iterations = ops;
+    result.nsPerOp = ops ? double(nanos) / ops : 0;
+    result.allocsPerOp = ops ? double(allocs) / ops : 0;
+    return result;
+}
+
+QString originName(int index) {
+    return QString("host-%1").arg(index);
+}
+
+QByteArray encode(const QVariantMap &map) {
+    return QJsonDocument(QJsonObject::fromVariantMap(map)).toJson();
+}
+
+//mixed traffic as seen by processIncomingDatagrams; DISCOVERY and PRIVATE_MESSAGE are left
+//out because they make the receiver send
+std::vector<QVariantMap> makeTraffic(int count, int origins, QRandomGenerator &rng) {
+    std::vector<QVariantMap> traffic;
+    std::vector<int> nextSeq(origins, 1);
+
+    for (int i = 0; i < count; ++i) {
+        int o = int(rng.bounded(quint32(origins)));
+        QVariantMap msg;
+        switch (rng.bounded(10)) {
+        case 0:
+        case 1:
+            msg["Type"] = "ROUTE_RUMOR";
+            msg["Origin"] = originName(o);
+            msg["SeqNo"] = nextSeq[o]++;
+            msg["LastIP"] = QString("10.0.%1.%2").arg(o / 256).arg(o % 256);
+            msg["LastPort"] = 45454;
+            break;
+        case 2:
+            msg["Type"] = "SEARCH_RESPONSE";
+            msg["Origin"] = originName(o);
+            msg["Dest"] = originName(0);
+            msg["MatchNames"] = QStringList{"holiday photo 1.jpg", "holiday photo 2.jpg"};
+            msg["MatchSizes"] = QVariantList{204800, 198765};
+            msg["MatchIDs"] = QStringList{QString(64, 'a'), QString(64, 'b')};
+            break;
+        case 3:
+            msg["Type"] = "BLOCK_REPLY";
+            msg["Origin"] = originName(o);
+            msg["Dest"] = originName(0);
+            msg["BlockReply"] = QString(64, 'c');
+            msg["BlockID"] = int(rng.bounded(64));
+            msg["TotalBlocks"] = 64;
+            msg["BlockData"] = QByteArray(1024, 'x');
+            break;
+        default:
+            msg["Type"] = "CHAT";
+            msg["Origin"] = originName(o);
+            msg["SequenceNumber"] = nextSeq[o]++;
+            msg["ChatText"] = QString("message %1 from %2, just some ordinary chat text").arg(i).arg(o);
+            msg["HopLimit"] = 10;
+            break;
+        }
+        traffic.push_back(msg);
+    }
+    return traffic;
+}
+
+//one more than the highest sequence number in the traffic; adding a multiple of it per pass
+//keeps every pass newer than the last, so the update paths are timed and not the stale ones
+int sequenceStride(const std::vector<QVariantMap> &traffic) {
+    int highest = 0;
+    for (const QVariantMap &msg : traffic) {
+        highest = std::max({highest, msg.value("SequenceNumber").toInt(), msg.value("SeqNo").toInt()});
+    }
+    return highest + 1;
+}
+
+//the message as sent in the given pass over the traffic
+QVariantMap withPass(QVariantMap msg, int pass, int stride) {
+    if (msg.contains("SequenceNumber")) msg["SequenceNumber"] = msg["SequenceNumber"].toInt() + pass * stride;
+    if (msg.contains("SeqNo")) msg["SeqNo"] = msg["SeqNo"].toInt() + pass * stride;
+    return msg;
+}
+
+} //namespace
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("p2pal_microbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Micro-benchmarks for the P2Pal per-datagram hot paths");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"min-time", "Minimum measured time per benchmark in ms.", "ms", "300"},
+        {"filter", "Only run benchmarks whose name contains this text.", "text"},
+        {"origins", "Distinct message origins in the synthetic traffic.", "n", "1000"},
+        {"files", "Files in the search index.", "n", "10000"},
+        {"port", "Loopback port for the receive-path benchmark.", "port", "45499"},
+        {"json", "Print results as JSON instead of a table."},
+    });
+    parser.process(app);
+    qInstallMessageHandler(silentMessageHandler);
+
+    BenchOptions opts;
+    opts.minTimeMs = parser.value("min-time").toInt();
+    opts.filter = parser.value("filter");
+    const int origins = std::max(1, parser.value("origins").toInt());
+    const int files = std::max(1, parser.value("files").toInt());
+    const quint16 port = quint16(parser.value("port").toUInt());
+
+    QRandomGenerator rng(42);
+    const std::vector<QVariantMap> traffic = makeTraffic(4096, origins, rng);
+    const int stride = sequenceStride(traffic);
+    std::vector<QByteArray> datagrams;
+    for (const QVariantMap &msg : traffic) datagrams.push_back(encode(msg));
+
+    std::vector<BenchResult> results;
+    auto enabled = [&](const QString &name) {
+        return opts.filter.isEmpty() || name.contains(opts.filter);
+    };
+    auto add = [&](const BenchResult &r) { results.push_back(r); };
+    const int batchSize = int(traffic.size());
+
+    //--- JSON decode/encode as done per datagram ---
+    //json_decode follows the receive path: parse, look up the type, build only that typed message
+    if (enabled("json_decode")) {
+        add(runBench("json_decode", opts, [&]() {
+            for (const QByteArray &d : datagrams) {
+                const QJsonObject json = QJsonDocument::fromJson(d).object();
+                switch (messageTypeOf(json)) {
+                case MessageType::Chat:
+                    benchSink = benchSink + ChatMessage::fromJson(json).sequenceNumber;
+                    break;
+                case MessageType::RouteRumor:
+                    benchSink = benchSink + RouteRumorMessage::fromJson(json).seqNo;
+                    break;
+                case MessageType::SearchResponse:
+                    benchSink = benchSink + SearchResponseMessage::fromJson(json).matchNames.size();
+                    break;
+                case MessageType::BlockReply:
+                    benchSink = benchSink + BlockReplyMessage::fromJson(json).blockID;
+                    break;
+                default:
+                    break;
+                }
+            }
+            return qint64(batchSize);
+        }));
+    }
+    //the previous QVariantMap conversion, kept as a reference point
+    if (enabled("json_decode_variantmap")) {
+        add(runBench("json_decode_variantmap", opts, [&]() {
+            for (const QByteArray &d : datagrams) {
+                QJsonDocument doc = QJsonDocument::fromJson(d);
+                QVariantMap messageMap = doc.object().toVariantMap();
+                benchSink = benchSink + messageMap["Type"].toString().size();
+            }
+            return qint64(batchSize);
+        }));
+    }
+    if (enabled("json_encode")) {
+        add(runBench("json_encode", opts, [&]() {
+            for (const QVariantMap &msg : traffic) benchSink = benchSink + encode(msg).size();
+            return qint64(batchSize);
+        }));
+    }
+
+    //--- forwardMessage on CHAT traffic: parse, decrement HopLimit, re-encode, fan out ---
+    //loss is set to 1 so the writes are dropped before the syscall and only CPU work is measured
+    if (enabled("forward_message")) {
+        std::vector<QByteArray> chats;
+        for (size_t i = 0; i < traffic.size(); ++i) {
+            if (traffic[i]["Type"].toString() == "CHAT") chats.push_back(datagrams[i]);
+        }
+        Networking node;
+        node.setLinkImpairment(1.0, 0);
+        node.setBatching(0);  //no event loop here to run the flush timer
+        node.setViewSizes(8, 0);  //keep the fan-out at 8 neighbours
+        for (int p = 0; p < 8; ++p) node.addPeer(QHostAddress(quint32(0x7F000100u + p)));
+        const QHostAddress sender(quint32(0x7F000200u));  //not a neighbour, so all 8 get a copy
+        add(runBench("forward_message", opts, [&]() {
+            for (const QByteArray &d : chats) node.forwardMessage(d, sender);
+            return qint64(chats.size());
+        }));
+    }
+
+    //--- outbound batching: queue compact chats for 8 peers, then flush ---
+    if (enabled("batch_flush")) {
+        std::vector<QByteArray> chats;
+        for (const QVariantMap &msg : traffic) {
+            if (msg["Type"].toString() == "CHAT") {
+                chats.push_back(QJsonDocument(QJsonObject::fromVariantMap(msg)).toJson(QJsonDocument::Compact));
+            }
+        }
+        OutboundBatcher batcher([](const QByteArray &datagram, const QHostAddress &, quint16, MessageType) {
+            benchSink = benchSink + datagram.size();
+        });
+        batcher.setFlushWindow(1000);
+        add(runBench("batch_flush", opts, [&]() {
+            for (size_t i = 0; i < chats.size(); ++i) {
+                batcher.enqueue(chats[i], QHostAddress(quint32(0x7F000100u + i % 8)), 45454, MessageType::Chat);
+            }
+            batcher.flush();
+            return qint64(chats.size());
+        }));
+    }
+
+    //--- VectorClock with many origins ---
+    if (enabled("vectorclock")) {
+        std::vector<QString> names;
+        for (int o = 0; o < origins; ++o) names.push_back(originName(o));
+        std::vector<QPair<int, int>> ops;
+        for (int i = 0; i < 4096; ++i) ops.push_back({int(rng.bounded(quint32(origins))), int(rng.bounded(100000))});
+
+        VectorClock clock;
+        for (int o = 0; o < origins; ++o) clock.updateClock(names[o], 50000);
+        add(runBench("vectorclock_is_new", opts, [&]() {
+            for (const auto &op : ops) benchSink = benchSink + clock.isNewMessage(names[op.first], op.second);
+            return qint64(ops.size());
+        }));
+        int pass = 0;
+        add(runBench("vectorclock_update", opts, [&]() {
+            int offset = ++pass * 100000;  //ops stay below 100000
+            for (const auto &op : ops) clock.updateClock(names[op.first], op.second + offset);
+            return qint64(ops.size());
+        }));
+    }
+
+    //--- updateRoutingTable with ROUTE_RUMOR payloads ---
+    if (enabled("update_routing_table")) {
+        Networking node;
+        std::vector<RouteRumorMessage> rumors;
+        for (const QVariantMap &msg : traffic) {
+            if (msg["Type"].toString() == "ROUTE_RUMOR") {
+                rumors.push_back(RouteRumorMessage::fromJson(QJsonObject::fromVariantMap(msg)));
+            }
+        }
+        const QHostAddress sender(quint32(0x7F000102u));
+        int pass = 0;
+        add(runBench("update_routing_table", opts, [&]() {
+            int offset = ++pass * stride;
+            for (const RouteRumorMessage &msg : rumors) {
+                node.updateRoutingTable(msg.origin, sender, 45454, msg.seqNo + offset, msg.lastIP, msg.lastPort);
+            }
+            return qint64(rumors.size());
+        }));
+    }
+
+    //--- search over a large index, as answered by handleSearchRequest ---
+    if (enabled("search")) {
+        FileIndex index;
+        const QStringList words = {"holiday", "photo", "report", "draft", "final", "music",
+                                   "video", "notes", "backup", "scan"};
+        for (int f = 0; f < files; ++f) {
+            QString name = QString("%1 %2 %3.dat").arg(words[f % words.size()])
+                               .arg(words[(f / words.size()) % words.size()]).arg(f);
+            index.append({name, qint64(f) * 1024, QDateTime(), QByteArray(32, char(f))});
+        }
+        const QStringList queries = {"holiday", "photo draft", "nomatch", "report final 12"};
+        add(runBench("search_index", opts, [&]() {
+            for (const QString &q : queries) benchSink = benchSink + index.search(q).names.size();
+            return qint64(queries.size());
+        }));
+    }
+
+    //--- full receive path: readDatagram + parse + dispatch in processIncomingDatagrams ---
+    if (enabled("process_incoming")) {
+        Networking node;
+        node.setNodeId(originName(0));  //the replies in the traffic are addressed to this node
+        QUdpSocket sender;
+        if (!node.bind(QHostAddress::LocalHost, port)) {
+            qWarning() << "process_incoming skipped: cannot bind port" << port;
+        } else {
+            const int burst = 256;
+            int cursor = 0;
+            int pass = 0;
+            add(runBench("process_incoming", opts, [&]() {
+                quint64 before = node.getDatagramsReceived();
+                node.processIncomingDatagrams();
+                return qint64(node.getDatagramsReceived() - before);
+            }, [&]() {
+                //re-encoded with newer sequence numbers on every pass, so chats are not all duplicates
+                for (int i = 0; i < burst; ++i) {
+                    QByteArray datagram = pass == 0 ? datagrams[cursor] : encode(withPass(traffic[cursor], pass, stride));
+                    sender.writeDatagram(datagram, QHostAddress::LocalHost, port);
+                    cursor = (cursor + 1) % batchSize;
+                    if (cursor == 0) pass++;
+                }
+            }));
+        }
+    }
+
+    if (parser.isSet("json")) {
+        QJsonArray list;
+        for (const BenchResult &r : results) {
+            QJsonObject o;
+            o["name"] = r.name;
+            o["iterations"] = double(r.iterations);
+            o["ns_per_op"] = r.nsPerOp;
+            o["allocs_per_op"] = r.allocsPerOp;
+            list.append(o);
+        }
+        QJsonObject report;
+        report["benchmark"] = "p2pal_microbench";
+        report["qt_version"] = qVersion();
+        report["origins"] = origins;
+        report["files"] = files;
+        report["results"] = list;
+        QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+        fwrite(json.constData(), 1, json.size(), stdout);
+    } else {
+        printf("%-24s %12s %14s %14s\n", "benchmark", "iterations", "ns/op", "allocs/op");
+        for (const BenchResult &r : results) {
+            printf("%-24s %12lld %14.1f %14.2f\n", qPrintable(r.name), (long long)r.iterations,
+                   r.nsPerOp, r.allocsPerOp);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include "uimodels.h"
+#include <QApplication>
+#include <QStyle>
+#include <QStyleOption>
+#include <algorithm>
+
+ChatModel::ChatModel(int capacity, QObject *parent)
+    : QAbstractListModel(parent), capacity(qMax(1, capacity)) {}
+
+int ChatModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : lines.size();
+}
+
+QVariant ChatModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= lines.size()) return QVariant();
+    if (role == Qt::DisplayRole || role == Qt::ToolTipRole) return lines[index.row()];
+    return QVariant();
+}
+
+void ChatModel::appendLines(const QStringList &batch) {
+    if (batch.isEmpty()) return;
+    const QStringList incoming = batch.size() > capacity ? batch.mid(batch.size() - capacity) : batch;
+
+    int overflow = lines.size() + incoming.size() - capacity;
+    if (overflow > 0) {
+        beginRemoveRows(QModelIndex(), 0, overflow - 1);
+        lines.remove(0, overflow);
+        endRemoveRows();
+    }
+    beginInsertRows(QModelIndex(), lines.size(), lines.size() + incoming.size() - 1);
+    lines.append(incoming);
+    endInsertRows();
+}
+
+int PeerListModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : peers.size();
+}
+
+QVariant PeerListModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= peers.size() || role != Qt::DisplayRole) return QVariant();
+    return peers[index.row()];
+}
+
+//merge of two sorted lists, so selection and scroll position survive a refresh
+void PeerListModel::setPeers(QStringList updated) {
+    std::sort(updated.begin(), updated.end());
+    int i = 0;
+    int j = 0;
+    while (i < peers.size() || j < updated.size()) {
+        if (j >= updated.size() || (i < peers.size() && peers[i] < updated[j])) {
+            beginRemoveRows(QModelIndex(), i, i);
+            peers.removeAt(i);
+            endRemoveRows();
+        } else if (i >= peers.size() || updated[j] < peers[i]) {
+            beginInsertRows(QModelIndex(), i, i);
+            peers.insert(i, updated[j]);
+            endInsertRows();
+            ++i;
+            ++j;
+        } else {
+            ++i;
+            ++j;
+        }
+    }
+}
+
+SearchResultsModel::SearchResultsModel(int capacity, QObject *parent)
+    : QAbstractTableModel(parent), capacity(qMax(1, capacity)) {}
+
+int SearchResultsModel::rowCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : rows.size();
+}
+
+int SearchResultsModel::columnCount(const QModelIndex &parent) const {
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant SearchResultsModel::data(const QModelIndex &index, int role) const {
+    if (!index.isValid() || index.row() >= rows.size()) return QVariant();
+    const Result &r = rows[index.row()];
+
+    if (role == Qt::ToolTipRole && index.column() == Download) return QString("Click to download");
+    if (role != Qt::DisplayRole) return QVariant();
+    switch (index.column()) {
+    case FileName: return r.fileName;
+    case Size: return r.size / 1024;
+    case Owner: return r.owner;
+    case Download:
+        if (r.progress < 0) return QString("Download");
+        return r.progress >= 100 ? QString("Done") : QString("Downloading");
+    case Progress: return r.progress < 0 ? QVariant() : QVariant(r.progress);
+    }
+    return QVariant();
+}
+
+QVariant SearchResultsModel::headerData(int section, Qt::Orientation orientation, int role) const {
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+    static const QStringList headers = { "Filename", "Size (KB)", "Source Node", "Download", "Progress" };
+    return headers.value(section);
+}
+
+//the oldest rows make room once the table is full
+void SearchResultsModel::appendResults(const QList<Result> &results) {
+    QList<Result> fresh;
+    QSet<QString> batch;  //duplicates within this batch
+    for (const Result &r : results) {
+        QString key = r.owner + '/' + r.hash;
+        if (listed.contains(key) || batch.contains(key)) continue;
+        batch.insert(key);
+        fresh << r;
+    }
+    if (fresh.isEmpty()) return;
+    //trimmed before the keys are recorded, so a dropped result can still be listed later
+    if (fresh.size() > capacity) fresh = fresh.mid(fresh.size() - capacity);
+    for (const Result &r : fresh) listed.insert(r.owner + '/' + r.hash);
+
+    int overflow = rows.size() + fresh.size() - capacity;
+    if (overflow > 0) {
+        beginRemoveRows(QModelIndex(), 0, overflow - 1);
+        for (int i = 0; i < overflow; ++i) listed.remove(rows[i].owner + '/' + rows[i].hash);
+        rows.remove(0, overflow);
+        endRemoveRows();
+    }
+    beginInsertRows(QModelIndex(), rows.size(), rows.size() + fresh.size() - 1);
+    rows.append(fresh);
+    endInsertRows();
+}
+
+void SearchResultsModel::setProgress(const QString &hash, int percent) {
+    for (int row = 0; row < rows.size(); ++row) {
+        if (rows[row].hash != hash || rows[row].progress == percent) continue;
+        rows[row].progress = percent;
+        emit dataChanged(index(row, Download), index(row, Progress));
+    }
+}
+
+const SearchResultsModel::Result &SearchResultsModel::result(int row) const {
+    return rows[row];
+}
+
+void ProgressDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const {
+    const QVariant value = index.data();
+    if (!value.isValid()) {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+
+    QStyleOptionProgressBar bar;
+    bar.rect = option.rect.adjusted(2, 2, -2, -2);
+    bar.state = option.state | QStyle::State_Horizontal;
+    bar.minimum = 0;
+    bar.maximum = 100;
+    bar.progress = value.toInt();
+    bar.text = QString::number(bar.progress) + "%";
+    bar.textVisible = true;
+    QApplication::style()->drawControl(QStyle::CE_ProgressBar, &bar, painter);
+}
@@ -0,0 +1,80 @@
+#ifndef UIMODELS_H
+#define UIMODELS_H
+
+#include <QAbstractListModel>
+#include <QAbstractTableModel>
+#include <QList>
+#include <QSet>
+#include <QStringList>
+#include <QStyledItemDelegate>
+
+//chat lines for a QListView; only the newest lines are kept, the rest stay in the on-disk history
+class ChatModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    explicit ChatModel(int capacity = DEFAULT_CAPACITY, QObject *parent = nullptr);
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    void appendLines(const QStringList &batch);  //one insert (and at most one remove) per batch
+    constexpr static int DEFAULT_CAPACITY = 5000;
+
+private:
+    int capacity;
+    QStringList lines;
+};
+
+//sorted peer addresses; setPeers only inserts and removes the rows that changed
+class PeerListModel : public QAbstractListModel {
+    Q_OBJECT
+
+public:
+    using QAbstractListModel::QAbstractListModel;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    void setPeers(QStringList updated);
+
+private:
+    QStringList peers;
+};
+
+class SearchResultsModel : public QAbstractTableModel {
+    Q_OBJECT
+
+public:
+    enum Column { FileName, Size, Owner, Download, Progress, ColumnCount };
+
+    struct Result {
+        QString fileName;
+        qint64 size = 0;
+        QString owner;
+        QString hash;
+        int progress = -1;  //-1 until the download is requested
+    };
+
+    explicit SearchResultsModel(int capacity = DEFAULT_CAPACITY, QObject *parent = nullptr);
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    void appendResults(const QList<Result> &results);  //repeated (owner, hash) pairs are skipped
+    void setProgress(const QString &hash, int percent);
+    const Result &result(int row) const;
+    constexpr static int DEFAULT_CAPACITY = 2000;
+
+private:
+    int capacity;
+    QList<Result> rows;
+    QSet<QString> listed;  //owner + '/' + hash
+};
+
+//paints the Progress column as a progress bar instead of a widget per row
+class ProgressDelegate : public QStyledItemDelegate {
+    Q_OBJECT
+
+public:
+    using QStyledItemDelegate::QStyledItemDelegate;
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+};
+
+#endif
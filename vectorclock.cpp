@@ -1,14 +1,19 @@
 #include "vectorclock.h"
 
 void VectorClock::updateClock(const QString &origin, int sequenceNumber) {
-    if (!clock.contains(origin) || clock[origin] < sequenceNumber) {
-        clock[origin] = sequenceNumber;
+    auto it = clock.find(origin);
+    if (it == clock.end()) {
+        clock.insert(origin, sequenceNumber);
+    } else if (it.value() < sequenceNumber) {
+        it.value() = sequenceNumber;
     }
 }
 
-bool VectorClock::isNewMessage(const QString &origin, int sequenceNumber) {
-    return !clock.contains(origin) || clock[origin] < sequenceNumber;
+bool VectorClock::isNewMessage(const QString &origin, int sequenceNumber) const {
+    auto it = clock.constFind(origin);
+    return it == clock.constEnd() || it.value() < sequenceNumber;
 }
+
 QMap<QString, int> VectorClock::getClock() const {
     return clock;
 }
@@ -8,7 +8,7 @@ class VectorClock {
 public:
     QMap<QString, int> getClock() const;
     void updateClock(const QString &origin, int sequenceNumber);
-    bool isNewMessage(const QString &origin, int sequenceNumber);
+    bool isNewMessage(const QString &origin, int sequenceNumber) const;
 
 private:
     QMap<QString, int> clock;